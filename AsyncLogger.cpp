@@ -0,0 +1,241 @@
+#include "AsyncLogger.h"
+
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+
+const size_t AsyncLogger::CAPACITY;
+const size_t AsyncLogger::RECORD_SIZE;
+const size_t AsyncLogger::ENCODED_SIZE;
+const size_t AsyncLogger::BATCH_SIZE;
+
+/**
+ * @brief Waits on condition for at most 1 ms.
+ */
+static void waitBriefly( pthread_cond_t *cond, pthread_mutex_t *mutex )
+{
+    struct timespec deadline;
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_nsec += 1000000;
+    if( deadline.tv_nsec >= 1000000000 )
+    {
+        deadline.tv_nsec -= 1000000000;
+        ++deadline.tv_sec;
+    }
+    pthread_cond_timedwait( cond, mutex, &deadline );
+}
+
+AsyncLogger::AsyncLogger():
+    cells(new Cell[CAPACITY]),
+    enqueuePos(0),
+    dequeuePos(0),
+    console(NULL),
+    file(NULL),
+    overflow(LogOverflow::BLOCK),
+    running(false),
+    stopping(false),
+    sleeping(false),
+    written(0),
+    dropped(0),
+    blocked(0),
+    batches(0)
+{
+    for( size_t i = 0; i < CAPACITY; ++i )
+        cells[i].sequence.store( i, std::memory_order_relaxed );
+    pthread_mutex_init( &sleepMutex, NULL );
+    pthread_cond_init( &wakeup, NULL );
+    pthread_cond_init( &drained, NULL );
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    Stop();
+    delete [] cells;
+    pthread_cond_destroy( &drained );
+    pthread_cond_destroy( &wakeup );
+    pthread_mutex_destroy( &sleepMutex );
+}
+
+void AsyncLogger::Start( std::ostream *console, std::ostream *file, LogOverflow overflow, Encoder encoder )
+{
+    if( running )
+        return;
+
+    this->console = console;
+    this->file = file;
+    this->overflow = overflow;
+    this->encoder = encoder;
+    stopping = false;
+    int rc = pthread_create( &writer, NULL, writerThread, this );
+    if( rc )
+        throw std::runtime_error( "Unable to create log writer thread, error code (" + std::to_string(rc) + ")." );
+    running = true;
+}
+
+void AsyncLogger::Stop( )
+{
+    if( running )
+    {
+        stopping = true;
+        wakeWriter();
+        pthread_join( writer, NULL );
+        running = false;
+    }
+
+    // Whatever was logged without a writer
+    while( writeBatch() );
+}
+
+void AsyncLogger::wakeWriter( )
+{
+    pthread_mutex_lock( &sleepMutex );
+    pthread_cond_signal( &wakeup );
+    pthread_mutex_unlock( &sleepMutex );
+}
+
+void AsyncLogger::Write( const char *text, size_t length )
+{
+    if( length > RECORD_SIZE - 1 )
+        length = RECORD_SIZE - 1;
+
+    bool waited = false;
+    Cell *cell;
+    size_t pos = enqueuePos.load( std::memory_order_relaxed );
+    while( true )
+    {
+        cell = &cells[pos & (CAPACITY - 1)];
+        size_t sequence = cell->sequence.load( std::memory_order_acquire );
+        long diff = (long)sequence - (long)pos;
+        if( diff == 0 )
+        {
+            // Cell is free for this lap, claim it
+            if( enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                break;
+        }
+        else if( diff < 0 )
+        {
+            // Ring is full, writer hasn't freed this cell from the last lap
+            if( overflow == LogOverflow::DROP || !running )
+            {
+                ++dropped;
+                return;
+            }
+            if( !waited )
+            {
+                ++blocked;
+                waited = true;
+            }
+            pthread_mutex_lock( &sleepMutex );
+            pthread_cond_signal( &wakeup );
+            waitBriefly( &drained, &sleepMutex );
+            pthread_mutex_unlock( &sleepMutex );
+            pos = enqueuePos.load( std::memory_order_relaxed );
+        }
+        else
+            pos = enqueuePos.load( std::memory_order_relaxed );
+    }
+
+    memcpy( cell->text, text, length );
+    cell->length = length;
+    cell->sequence.store( pos + 1, std::memory_order_release );
+
+    // Writer sets sleeping before it checks the ring, so one of us sees the other
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( sleeping.load( std::memory_order_relaxed ) )
+        wakeWriter();
+}
+
+size_t AsyncLogger::writeBatch( )
+{
+    char encoded[ENCODED_SIZE];
+    size_t count = 0;
+    while( count < BATCH_SIZE )
+    {
+        Cell &cell = cells[dequeuePos & (CAPACITY - 1)];
+        if( cell.sequence.load( std::memory_order_acquire ) != dequeuePos + 1 )
+            break;
+
+        const char *text = cell.text;
+        size_t length = cell.length;
+        if( encoder )
+        {
+            length = encoder( cell.text, cell.length, encoded );
+            text = encoded;
+        }
+        if( console )
+            console->write( text, length );
+        if( file )
+            file->write( text, length );
+
+        // Free the cell for the next lap
+        cell.sequence.store( dequeuePos + CAPACITY, std::memory_order_release );
+        ++dequeuePos;
+        ++count;
+    }
+    if( !count )
+        return 0;
+
+    if( console )
+        console->flush();
+    if( file )
+        file->flush();
+    ++batches;
+
+    pthread_mutex_lock( &sleepMutex );
+    written += count;
+    pthread_cond_broadcast( &drained );
+    pthread_mutex_unlock( &sleepMutex );
+    return count;
+}
+
+void *AsyncLogger::writerThread( void *p )
+{
+    AsyncLogger *log = (AsyncLogger *)p;
+    while( true )
+    {
+        if( log->writeBatch() )
+            continue;
+
+        pthread_mutex_lock( &log->sleepMutex );
+        log->sleeping = true;
+        while( !log->stopping )
+        {
+            const Cell &next = log->cells[log->dequeuePos & (CAPACITY - 1)];
+            if( next.sequence.load( std::memory_order_acquire ) == log->dequeuePos + 1 )
+                break;
+            pthread_cond_wait( &log->wakeup, &log->sleepMutex );
+        }
+        log->sleeping = false;
+        pthread_mutex_unlock( &log->sleepMutex );
+
+        if( log->stopping && !log->writeBatch() )
+        {
+            // Records claimed but not filled in yet are written by Stop
+            break;
+        }
+    }
+    return NULL;
+}
+
+void AsyncLogger::Flush( )
+{
+    size_t target = enqueuePos.load();
+    if( running )
+    {
+        pthread_mutex_lock( &sleepMutex );
+        while( written < target )
+        {
+            pthread_cond_signal( &wakeup );
+            waitBriefly( &drained, &sleepMutex );
+        }
+        pthread_mutex_unlock( &sleepMutex );
+    }
+    else
+        while( written < target && writeBatch() );
+}
+
+LogStats AsyncLogger::Stats( ) const
+{
+    return LogStats{ written, batches, dropped, blocked };
+}
@@ -0,0 +1,136 @@
+#ifndef _ASYNC_LOGGER
+#define _ASYNC_LOGGER
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+
+#include <pthread.h>
+
+/**
+ * @brief What producers do when the log ring is full.
+ *
+ */
+enum class LogOverflow{
+    BLOCK,  // Wait for the writer to make room
+    DROP    // Discard the record and count it
+};
+
+/**
+ * @brief Counters of AsyncLogger.
+ *
+ */
+struct LogStats
+{
+    unsigned long records;
+    unsigned long batches;
+    unsigned long dropped;
+    unsigned long blocked;  // Records whose producer waited for room
+};
+
+/**
+ * @brief Log with a bounded lock-free ring and a background writer thread.
+ * @details Producers format their record into a ring cell and go on, the
+ *          ring is a bounded multi-producer queue where every cell carries a
+ *          sequence number telling whether it is free or filled for the
+ *          current lap. Writer thread drains filled cells in batches and
+ *          writes every batch to outputs with a single flush. Writer sleeps
+ *          while the ring is empty, producers wake it only if it does.
+ *
+ */
+class AsyncLogger
+{
+    public:
+        static const size_t RECORD_SIZE = 512;
+        static const size_t ENCODED_SIZE = 2 * RECORD_SIZE;
+
+        /**
+         * @brief Turns record into what is written, called by the writer in ring order.
+         * @details Gets record and its length and a buffer of ENCODED_SIZE bytes,
+         *          returns the number of bytes it put there.
+         */
+        typedef std::function<size_t( const char *record, size_t length, char *out )> Encoder;
+
+    private:
+        static const size_t CAPACITY = 8192;   // Power of two
+        static const size_t BATCH_SIZE = 256;
+
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            size_t length;
+            char text[RECORD_SIZE];
+        };
+
+        Cell *cells;
+        std::atomic<size_t> enqueuePos;
+        size_t dequeuePos;
+
+        std::ostream *console;
+        std::ostream *file;
+        LogOverflow overflow;
+        Encoder encoder;
+
+        pthread_t writer;
+        bool running;
+        std::atomic<bool> stopping;
+        std::atomic<bool> sleeping;
+        std::atomic<size_t> written;            // Records written so far
+        pthread_mutex_t sleepMutex;
+        pthread_cond_t wakeup;                  // Ring got a record, or stop
+        pthread_cond_t drained;                 // Writer made room or wrote a batch
+
+        std::atomic<unsigned long> dropped;
+        std::atomic<unsigned long> blocked;
+        std::atomic<unsigned long> batches;
+
+        static void *writerThread( void *logger );
+
+        /**
+         * @brief Writes filled cells to outputs.
+         * @return Number of records written.
+         */
+        size_t writeBatch( );
+
+        void wakeWriter( );
+
+    public:
+        AsyncLogger();
+        ~AsyncLogger();
+
+        /**
+         * @brief Sets outputs and starts writer thread.
+         *
+         * @param console Stream for monitor output, NULL for none.
+         * @param file Stream for file output, NULL for none.
+         * @param overflow What producers do when the ring is full.
+         * @param encoder Encodes records before they are written, empty to write them as they are.
+         */
+        void Start( std::ostream *console, std::ostream *file, LogOverflow overflow, Encoder encoder = Encoder() );
+
+        /**
+         * @brief Adds record to the log, safe to call from any thread.
+         *
+         * @param text Record text, cut to RECORD_SIZE - 1 characters.
+         * @param length Length of text.
+         */
+        void Write( const char *text, size_t length );
+
+        /**
+         * @brief Waits until every record written so far is in outputs.
+         */
+        void Flush( );
+
+        /**
+         * @brief Writes remaining records and joins writer thread.
+         */
+        void Stop( );
+
+        /**
+         * @brief Returns counters, records written, batches, dropped and blocked records.
+         */
+        LogStats Stats( ) const;
+};
+
+#endif // _ASYNC_LOGGER
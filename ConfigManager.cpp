@@ -1,180 +1,295 @@
 #include "ConfigManager.h"
 
+#include <cctype>
+#include <cstdlib>
 #include <stdexcept>
 
 using std::string;
+using std::string_view;
 using std::to_string;
-using std::vector;
 using std::runtime_error;
 using std::invalid_argument;
 
-ConfigManager::ConfigManager(){
-    
-}
-ConfigManager::~ConfigManager(){
-    configOptions.clear();
+ConfigSchema::ConfigSchema( const ConfigOptionSpec *options, size_t count ) :
+    options( options ), count( count )
+{
+    index.reserve( count );
+    for( size_t i = 0; i < count; ++i )
+        index.insert({ options[i].label, i });
 }
 
-bool ConfigManager::AddOption( string label, ConfigType type )
+size_t ConfigSchema::Find( string_view label ) const
 {
-    ConfigOption * option = GetOption(label);
-    if( option != NULL)
-        return false;
+    auto search = index.find(label);
+    return search != index.end() ? search->second : npos;
+}
 
-    ConfigOption newOption;
-    newOption.type = type;
-    newOption.initialized = false;
-    configOptions.insert({label, newOption});
+////////////////////////////////////////////////////////////////////////////////
 
-    return true;
+ConfigManager::ConfigManager( const ConfigSchema &schema ) :
+    schema( schema ), configOptions( schema.Count() )
+{
+    for( size_t i = 0; i < schema.Count(); ++i )
+    {
+        const ConfigOptionSpec &spec = schema.Option(i);
+        configOptions[i].initialized = false;
+        if( !spec.required )
+            SetStr( spec.label, spec.defaultValue );
+    }
 }
-void ConfigManager::RemoveOption( string label )
+ConfigManager::~ConfigManager(){
+    configOptions.clear();
+}
+
+size_t ConfigManager::find( string_view label, const char *caller ) const
 {
-    configOptions.erase( label );
+    size_t i = schema.Find(label);
+    if( i == ConfigSchema::npos )
+        throw runtime_error( string("ConfigManager::") + caller + " Attempt to access invalid config option (" + string(label) + ")" );
+    return i;
 }
 
-bool ConfigManager::OptionExist( string label )
+bool ConfigManager::OptionExist( string_view label ) const
 {
-    ConfigOption * option = GetOption(label);
-    return option != NULL;
+    return schema.Find(label) != ConfigSchema::npos;
 }
 
-bool ConfigManager::OptionInitialized( string label )
+bool ConfigManager::OptionInitialized( string_view label ) const
 {
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error("ConfigManager::OptionInitialized Attempt to access invalid config option (" + label + ")");
-    return option->initialized;
+    return configOptions[find( label, "OptionInitialized" )].initialized;
 }
 
-ConfigType ConfigManager::OptionType( string label )
+ConfigType ConfigManager::OptionType( string_view label ) const
 {
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error( "ConfigManager::OptionType Attempt to access invalid config option (" + label + ")" );
-    return option->type;
+    return schema.Option( find( label, "OptionType" ) ).type;
 }
 
 
 
-void ConfigManager::SetStr( string label, string strVal )
+void ConfigManager::SetStr( string_view label, string_view strVal )
 {
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error( "ConfigManager::SetStr Attempt to access invalid config option (" + label + ")" );
-    switch(option->type)
+    size_t i = find( label, "SetStr" );
+    ConfigOption * option = &configOptions[i];
+    string value( strVal );
+    switch(schema.Option(i).type)
     {
         case ConfigType::Int:
             {
                 char* endptr = 0;
-                long int v = strtol(strVal.c_str(), &endptr, 10);
+                long int v = strtol(value.c_str(), &endptr, 10);
 
-                if(*endptr != '\0' || endptr == strVal)
-                    throw invalid_argument( "ConfigManager::SetStr Attempt to set invalid int for config option (" + label + ")" );
-                option->value_s = strVal;
+                if(*endptr != '\0' || endptr == value.c_str())
+                    throw invalid_argument( "ConfigManager::SetStr Attempt to set invalid int for config option (" + string(label) + ")" );
+                option->value_s = value;
                 option->value_i = v;
                 option->initialized = true;
             } break;
         case ConfigType::Double:
             {
                 char* endptr = 0;
-                double v = strtod(strVal.c_str(), &endptr);
+                double v = strtod(value.c_str(), &endptr);
 
-                if(*endptr != '\0' || endptr == strVal)
-                    throw invalid_argument( "ConfigManager::SetStr Attempt to set invalid double for config option (" + label + ")" );
-                option->value_s = strVal;
+                if(*endptr != '\0' || endptr == value.c_str())
+                    throw invalid_argument( "ConfigManager::SetStr Attempt to set invalid double for config option (" + string(label) + ")" );
+                option->value_s = value;
                 option->value_d = v;
                 option->initialized = true;
             } break;
         case ConfigType::String:
             {
-                option->value_s = strVal;
+                option->value_s = value;
                 option->initialized = true;
             }
     }
 }
-void ConfigManager::SetInt( string label, long int val )
+void ConfigManager::SetInt( string_view label, long int val )
 {
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error( "ConfigManager::Set Attempt to access invalid config option (" + label + ")" );
-    if( option->type != ConfigType::Int )
-        throw runtime_error( "ConfigManager::Set Attempt to modify config option with incorrect type (" + label + ")" );
+    size_t i = find( label, "Set" );
+    if( schema.Option(i).type != ConfigType::Int )
+        throw runtime_error( "ConfigManager::Set Attempt to modify config option with incorrect type (" + string(label) + ")" );
+    ConfigOption * option = &configOptions[i];
     option->value_s = to_string(val);
     option->value_i = val;
     option->initialized = true;
 }
-void ConfigManager::SetDouble( string label, double val )
+void ConfigManager::SetDouble( string_view label, double val )
 {
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error( "ConfigManager::Set Attempt to access invalid config option (" + label + ")" );
-    if( option->type != ConfigType::Double )
-        throw runtime_error( "ConfigManager::Set Attempt to modify config option with incorrect type (" + label + ")" );
-    
+    size_t i = find( label, "Set" );
+    if( schema.Option(i).type != ConfigType::Double )
+        throw runtime_error( "ConfigManager::Set Attempt to modify config option with incorrect type (" + string(label) + ")" );
+    ConfigOption * option = &configOptions[i];
     option->value_s = to_string(val);
     option->value_d = val;
     option->initialized = true;
 }
-void ConfigManager::Set( string label, string val )
+void ConfigManager::Set( string_view label, string_view val )
 {
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error( "ConfigManager::Set Attempt to access invalid config option (" + label + ")" );
-    if( option->type != ConfigType::String )
-        throw runtime_error( "ConfigManager::Set Attempt to modify config option with incorrect type (" + label + ")" );
-    
+    size_t i = find( label, "Set" );
+    if( schema.Option(i).type != ConfigType::String )
+        throw runtime_error( "ConfigManager::Set Attempt to modify config option with incorrect type (" + string(label) + ")" );
+    ConfigOption * option = &configOptions[i];
     option->value_s = val;
     option->initialized = true;
 }
-ConfigOption * ConfigManager::GetOption( string label )
+
+void ConfigManager::Validate( ) const
 {
-    auto search = configOptions.find(label);
-    if(search != configOptions.end()) {
-        return &(search->second);
+    for( size_t i = 0; i < schema.Count(); ++i )
+    {
+        if( !configOptions[i].initialized )
+            throw runtime_error( "\"" + string(schema.Option(i).label) + "\" config option is not initialized" );
+    }
+    for( size_t i = 0; i < schema.Count(); ++i )
+    {
+        const ConfigOptionSpec &spec = schema.Option(i);
+        if( spec.values )
+        {
+            checkValues( spec, configOptions[i].value_s );
+            continue;
+        }
+        long int value = configOptions[i].value_i;
+        if( spec.type != ConfigType::Int || (value >= spec.min && value <= spec.max) )
+            continue;
+        if( spec.max == LONG_MAX )
+            throw runtime_error( string(spec.label) + " must be at least " + to_string(spec.min) + "." );
+        if( spec.min == LONG_MIN )
+            throw runtime_error( string(spec.label) + " must be at most " + to_string(spec.max) + "." );
+        throw runtime_error( string(spec.label) + " must be between " + to_string(spec.min) + " and " + to_string(spec.max) + "." );
     }
-    return NULL;
 }
-void ConfigManager::GetOptionLabels( vector<string> &labels )
+
+// White space of \s in config line grammar
+static bool isConfigSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Compares ASCII strings ignoring case
+static bool equalsNoCase( string_view a, string_view b )
 {
-    labels.clear();
-    for ( auto it = configOptions.begin(); it != configOptions.end(); ++it )
-        labels.push_back( it->first );
+    if( a.size() != b.size() )
+        return false;
+    for( size_t i = 0; i < a.size(); ++i )
+        if( tolower( (unsigned char)a[i] ) != tolower( (unsigned char)b[i] ) )
+            return false;
+    return true;
 }
 
-long int ConfigManager::GetInt( string label )
+void ConfigManager::checkValues( const ConfigOptionSpec &spec, string_view value )
 {
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error( "ConfigManager::GetInt Attempt to access invalid config option (" + label + ")" );
-    if( option->type != ConfigType::Int )
-        throw runtime_error( "ConfigManager::GetInt Attempt to access config option with incorrect type (" + label + ")" );
-    if( !option->initialized )
-        throw runtime_error( "ConfigManager::GetInt Attempt to access uninitialized config option (" + label + ")" );
-    
-    return option->value_i;
+    // List items are trimmed, empty item after the last comma is allowed
+    while( true )
+    {
+        size_t comma = spec.list ? value.find(',') : string_view::npos;
+        string_view item = value.substr( 0, comma );
+        if( spec.list )
+        {
+            while( !item.empty() && isConfigSpace( item.front() ) )
+                item.remove_prefix(1);
+            while( !item.empty() && isConfigSpace( item.back() ) )
+                item.remove_suffix(1);
+        }
+
+        bool valid = false;
+        for( size_t i = 0; i < spec.valueCount && !valid; ++i )
+            valid = equalsNoCase( item, spec.values[i] );
+        if( !valid && !(spec.list && item.empty() && comma == string_view::npos) )
+        {
+            string possible;
+            for( size_t i = 0; i < spec.valueCount; ++i )
+            {
+                if( i )
+                    possible += i + 1 == spec.valueCount ? " and " : ", ";
+                possible += spec.values[i];
+            }
+            throw runtime_error( "\"" + string(item) + "\" is an invalid " + string(spec.label)
+                + " value. Possible values are " + possible + "." );
+        }
+
+        if( comma == string_view::npos )
+            return;
+        value.remove_prefix( comma + 1 );
+    }
+}
+
+long int ConfigManager::GetInt( string_view label ) const
+{
+    size_t i = find( label, "GetInt" );
+    if( schema.Option(i).type != ConfigType::Int )
+        throw runtime_error( "ConfigManager::GetInt Attempt to access config option with incorrect type (" + string(label) + ")" );
+    if( !configOptions[i].initialized )
+        throw runtime_error( "ConfigManager::GetInt Attempt to access uninitialized config option (" + string(label) + ")" );
+
+    return configOptions[i].value_i;
 };
 
-double ConfigManager::GetDouble( string label )
-{
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error( "ConfigManager::GetDouble Attempt to access invalid config option (" + label + ")" );
-    if( option->type != ConfigType::Double )
-        throw runtime_error( "ConfigManager::GetDouble Attempt to access config option with incorrect type (" + label + ")" );
-    if( !option->initialized )
-        throw runtime_error( "ConfigManager::GetDouble Attempt to access uninitialized config option (" + label + ")" );
-    
-    return option->value_d;
-}
-
-string ConfigManager::GetStr( string label )
-{
-    ConfigOption * option = GetOption(label);
-    if( option == NULL)
-        throw runtime_error("ConfigManager::GetStr Attempt to access invalid config option (" + label + ")" );
-    if( !option->initialized )
-        throw runtime_error("ConfigManager::GetStr Attempt to access uninitialized config option (" + label + ")" );
-    
-    return option->value_s;
-}
\ No newline at end of file
+double ConfigManager::GetDouble( string_view label ) const
+{
+    size_t i = find( label, "GetDouble" );
+    if( schema.Option(i).type != ConfigType::Double )
+        throw runtime_error( "ConfigManager::GetDouble Attempt to access config option with incorrect type (" + string(label) + ")" );
+    if( !configOptions[i].initialized )
+        throw runtime_error( "ConfigManager::GetDouble Attempt to access uninitialized config option (" + string(label) + ")" );
+
+    return configOptions[i].value_d;
+}
+
+const string &ConfigManager::GetStr( string_view label ) const
+{
+    size_t i = find( label, "GetStr" );
+    if( !configOptions[i].initialized )
+        throw runtime_error("ConfigManager::GetStr Attempt to access uninitialized config option (" + string(label) + ")" );
+
+    return configOptions[i].value_s;
+}
+
+
+// Label and value are on one line, other white space than space and tab ends them
+static bool isOneLine( string_view text )
+{
+    return text.find_first_of( "\n\v\f\r" ) == string_view::npos;
+}
+
+bool ConfigManager::ParseLine( string_view line, string_view &label, string_view &value )
+{
+    size_t begin = 0;
+    size_t end = line.size();
+    while( begin < end && isConfigSpace( line[begin] ) )
+        ++begin;
+    while( end > begin && isConfigSpace( line[end - 1] ) )
+        --end;
+
+    // Label is shortest one, it ends at the first colon a value follows
+    for( size_t colon = line.find( ':', begin ); colon != string_view::npos; colon = line.find( ':', colon + 1 ) )
+    {
+        size_t labelEnd = colon;
+        while( labelEnd > begin && isConfigSpace( line[labelEnd - 1] ) )
+            --labelEnd;
+        if( !isOneLine( line.substr( begin, labelEnd - begin ) ) )
+            return false;
+
+        size_t valueBegin = colon + 1;
+        while( valueBegin < end && isConfigSpace( line[valueBegin] ) )
+            ++valueBegin;
+        if( valueBegin < end )
+        {
+            if( !isOneLine( line.substr( valueBegin, end - valueBegin ) ) )
+                continue;
+            label = line.substr( begin, labelEnd - begin );
+            value = line.substr( valueBegin, end - valueBegin );
+            return true;
+        }
+
+        // Only white space follows, value is the last space or tab of it
+        for( size_t i = line.size(); i > colon + 1; --i )
+        {
+            if( line[i - 1] == ' ' || line[i - 1] == '\t' )
+            {
+                label = line.substr( begin, labelEnd - begin );
+                value = line.substr( i - 1, 1 );
+                return true;
+            }
+        }
+    }
+    return false;
+}
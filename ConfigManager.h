@@ -1,14 +1,17 @@
 #ifndef _CONFIG_MANAGER
 #define _CONFIG_MANAGER
 
+#include <climits>
+#include <cstddef>
 #include <unordered_map>
 #include <vector>
 
 #include <string>
+#include <string_view>
 
 /**
  * @brief Enumeration for config option value type.
- * 
+ *
  */
 enum class ConfigType
 {
@@ -16,15 +19,126 @@ enum class ConfigType
 };
 
 /**
- * @brief Data structure used by ConfigManager 
+ * @brief Declaration of config option in a config schema.
+ * @details Schemas are constexpr arrays of options, made with
+ * 			ConfigRequired and ConfigDefault. String option may list the
+ * 			values it takes, matched ignoring case.
+ *
+ */
+struct ConfigOptionSpec
+{
+	std::string_view label;
+	ConfigType type;
+	bool required;					// Has no default, config file must set it
+	std::string_view defaultValue;	// As written in config file
+	long int min;					// Range of Int option
+	long int max;
+	const std::string_view *values;	// Values of String option, NULL for any
+	size_t valueCount;
+	bool list;						// Value is comma separated list of values
+};
+
+/**
+ * @brief Declares config option that config file must set.
+ *
+ * @param label Config option label.
+ * @param type Config option type.
+ * @param min,max Range of Int option.
+ */
+constexpr ConfigOptionSpec ConfigRequired( std::string_view label, ConfigType type,
+	long int min = LONG_MIN, long int max = LONG_MAX )
+{
+	return ConfigOptionSpec{ label, type, true, std::string_view(), min, max, nullptr, 0, false };
+}
+
+/**
+ * @brief Declares String option that config file must set to one of values.
+ *
+ * @param label Config option label.
+ * @param values Values option takes.
+ */
+template <size_t N>
+constexpr ConfigOptionSpec ConfigRequired( std::string_view label, const std::string_view (&values)[N] )
+{
+	return ConfigOptionSpec{ label, ConfigType::String, true, std::string_view(), LONG_MIN, LONG_MAX, values, N, false };
+}
+
+/**
+ * @brief Declares config option with default value.
+ *
+ * @param label Config option label.
+ * @param type Config option type.
+ * @param value Default value, as written in config file.
+ * @param min,max Range of Int option.
+ */
+constexpr ConfigOptionSpec ConfigDefault( std::string_view label, ConfigType type, std::string_view value,
+	long int min = LONG_MIN, long int max = LONG_MAX )
+{
+	return ConfigOptionSpec{ label, type, false, value, min, max, nullptr, 0, false };
+}
+
+/**
+ * @brief Declares String option set to one of values, with default value.
+ *
+ * @param label Config option label.
+ * @param values Values option takes.
+ * @param value Default value.
+ * @param list True if option is comma separated list of values.
+ */
+template <size_t N>
+constexpr ConfigOptionSpec ConfigDefault( std::string_view label, const std::string_view (&values)[N],
+	std::string_view value, bool list = false )
+{
+	return ConfigOptionSpec{ label, ConfigType::String, false, value, LONG_MIN, LONG_MAX, values, N, list };
+}
+
+/**
+ * @brief Config options of a program, indexed by label.
+ * @details Index is built once, every ConfigManager of the schema shares it.
+ *
+ */
+class ConfigSchema
+{
+	private:
+		const ConfigOptionSpec *options;
+		size_t count;
+		std::unordered_map<std::string_view, size_t> index;
+
+	public:
+		template <size_t N>
+		ConfigSchema( const ConfigOptionSpec (&options)[N] ) : ConfigSchema( options, N ) { }
+		ConfigSchema( const ConfigOptionSpec *options, size_t count );
+
+		/**
+		 * @brief Returns number of options.
+		 */
+		size_t Count( ) const { return count; }
+
+		/**
+		 * @brief Returns option by its index in the schema.
+		 */
+		const ConfigOptionSpec &Option( size_t i ) const { return options[i]; }
+
+		/**
+		 * @brief Returns index of option in the schema.
+		 *
+		 * @param label Config option label.
+		 * @return Index, or npos if there is no such option.
+		 */
+		size_t Find( std::string_view label ) const;
+
+		static const size_t npos = (size_t)-1;
+};
+
+/**
+ * @brief Data structure used by ConfigManager
  * 		  to storing individual configuration options.
- * 
+ *
  */
 struct ConfigOption
 {
-	ConfigType type;
 	bool initialized;
-	
+
 	long int value_i;
 	double value_d;
 	std::string value_s;
@@ -33,136 +147,132 @@ struct ConfigOption
 class ConfigManager
 {
 	private:
-		std::unordered_map<std::string, ConfigOption> configOptions;
+		const ConfigSchema &schema;
+		std::vector<ConfigOption> configOptions;	// In schema order
+
+		size_t find( std::string_view label, const char *caller ) const;
+
+		/**
+		 * @brief Throws runtime_error listing values of option if value is not one of them.
+		 */
+		static void checkValues( const ConfigOptionSpec &spec, std::string_view value );
 
 	public:
 		/**
 		 * @brief Constructor for ConfigManager.
+		 * @details Options are those of the schema, set to their defaults.
+		 *
+		 * @param schema Config options, must outlive the config manager.
 		 */
-		ConfigManager();
+		ConfigManager( const ConfigSchema &schema );
 		/**
 		 * @brief Destructor for ConfigManager.
 		 */
 		~ConfigManager();
 
-		/**
-		 * @brief Adds config option to config manager.
-		 * @details Checks if config option already exist,
-		 * 			if not then it adds new option to config
-		 * 			manager.
-		 * 
-		 * @param label Config option label.
-		 * @param type Config option type.
-		 * 
-		 * @return True if config option created successfully.
-		 */
-		bool AddOption( std::string label, ConfigType type );
-
-		/**
-		 * @brief Removes option from config manager.
-		 * 
-		 * @param label Config option label.
-		 */
-		void RemoveOption( std::string label );
-
 		/**
 		 * @brief Checks whether config option exist or not in config manager.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @return True if config option exist.
 		 */
-		bool OptionExist( std::string label );
+		bool OptionExist( std::string_view label ) const;
 
 		/**
 		 * @brief Checks whether value has been set for config option.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @return True if config option is initialized.
 		 */
-		bool OptionInitialized( std::string label );
+		bool OptionInitialized( std::string_view label ) const;
 
 		/**
 		 * @brief Returns config option type for specified config option.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @return Config option type of config option.
 		 */
-		ConfigType OptionType( std::string label );
+		ConfigType OptionType( std::string_view label ) const;
 
 		/**
 		 * @brief Sets config option with value in string format.
 		 * @details Sets config option with value in string format. Automatically
-		 * 			converts the string into specific type according to config 
+		 * 			converts the string into specific type according to config
 		 * 			option type.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @param strVal Value to set in string format.
 		 */
-		void SetStr( std::string label, std::string strVal );
+		void SetStr( std::string_view label, std::string_view strVal );
 
 		/**
 		 * @brief Sets integer config option with the value.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @param int Value to set.
 		 */
-		void SetInt( std::string label, long int val );
-		
+		void SetInt( std::string_view label, long int val );
+
 		/**
 		 * @brief Sets double config option with the value.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @param int Value to set.
 		 */
-		void SetDouble( std::string label, double val );
-		
+		void SetDouble( std::string_view label, double val );
+
 		/**
 		 * @brief Sets string config option with the value.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @param int Value to set.
 		 */
-		void Set( std::string label, std::string val );
-
-		/**
-		 * @brief Returns pointer to config option data.
-		 * 
-		 * @param label Config option label.
-		 * @return Pointer to config option.
-		 */
-		ConfigOption * GetOption( std::string label );
+		void Set( std::string_view label, std::string_view val );
 
 		/**
-		 * @brief Populates labels vector with all config option labels.
-		 * 
-		 * @param labels string vector to populate with labels.
+		 * @brief Checks config options against the schema.
+		 * @details Throws runtime_error naming the first required option
+		 * 			that is not set, or else the first Int option out of
+		 * 			its range or String option not set to one of its values.
 		 */
-		void GetOptionLabels( std::vector<std::string> &labels );
+		void Validate( ) const;
 
 		/**
 		 * @brief Returns value of integet config option.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @return Value of config option.
 		 */
-		long int GetInt( std::string label );
+		long int GetInt( std::string_view label ) const;
 		/**
 		 * @brief Returns value of integet config option.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @return Value of config option.
 		 */
-		double GetDouble( std::string label );
+		double GetDouble( std::string_view label ) const;
 		/**
 		 * @brief Returns value of integet config option.
 		 * @details Returns value of integet config option. Unlike GetInt and GetDouble,
 		 * 			GetStr doesn't require for config option type to be string. It will
 		 * 			return integer and double types in string format.
-		 * 
+		 *
 		 * @param label Config option label.
 		 * @return Value of config option.
 		 */
-		std::string GetStr( std::string label );
+		const std::string &GetStr( std::string_view label ) const;
+
+		/**
+		 * @brief Splits line of config file into label and value.
+		 * @details Line is "label: value", white space around both is
+		 * 			dropped. Label ends at the first colon followed by a value.
+		 *
+		 * @param line Line of config file.
+		 * @param label Set to label, points into line.
+		 * @param value Set to value, points into line.
+		 * @return False if line is not a config option.
+		 */
+		static bool ParseLine( std::string_view line, std::string_view &label, std::string_view &value );
 };
 
 #endif // _CONFIG_MANAGER
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "JobHeap.h"
+
+const size_t JobHeap::ARITY;
+
+JobHeap::JobHeap():
+    seqCounter(0)
+{
+
+}
+
+bool JobHeap::before( const Entry &a, const Entry &b ) const
+{
+    if( a.job.key != b.job.key )
+        return a.job.key < b.job.key;
+    return a.seq < b.seq;
+}
+
+void JobHeap::siftUp( size_t index )
+{
+    Entry entry = entries[index];
+    while( index > 0 )
+    {
+        size_t parent = (index - 1) / ARITY;
+        if( !before( entry, entries[parent] ) )
+            break;
+        entries[index] = entries[parent];
+        index = parent;
+    }
+    entries[index] = entry;
+}
+
+void JobHeap::siftDown( size_t index )
+{
+    Entry entry = entries[index];
+    size_t size = entries.size();
+    while( true )
+    {
+        size_t first = index * ARITY + 1;
+        if( first >= size )
+            break;
+
+        size_t best = first;
+        size_t last = first + ARITY < size ? first + ARITY : size;
+        for( size_t child = first + 1; child < last; ++child )
+            if( before( entries[child], entries[best] ) )
+                best = child;
+
+        if( !before( entries[best], entry ) )
+            break;
+        entries[index] = entries[best];
+        index = best;
+    }
+    entries[index] = entry;
+}
+
+bool JobHeap::Empty( ) const
+{
+    return entries.empty();
+}
+
+size_t JobHeap::Size( ) const
+{
+    return entries.size();
+}
+
+void JobHeap::Push( const Job &job )
+{
+    entries.push_back( Entry{job, seqCounter++} );
+    siftUp( entries.size() - 1 );
+}
+
+const Job &JobHeap::Top( ) const
+{
+    return entries.front().job;
+}
+
+void JobHeap::Pop( )
+{
+    entries.front() = entries.back();
+    entries.pop_back();
+    if( !entries.empty() )
+        siftDown( 0 );
+}
+
+void JobHeap::Clear( )
+{
+    entries.clear();
+    seqCounter = 0;
+}
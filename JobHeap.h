@@ -0,0 +1,80 @@
+#ifndef _JOB_HEAP
+#define _JOB_HEAP
+
+#include <vector>
+#include <cstddef>
+
+struct PCB;
+
+/**
+ * @brief Used by scheduling queue to store processes
+ *
+ */
+struct Job
+{
+    PCB *process;
+    long key;
+};
+
+/**
+ * @brief 4-ary min-heap of jobs.
+ * @details Key of a job is fixed while it is queued, a process gets a new
+ *             one when it is pushed again. Jobs with equal keys are popped
+ *             in the order they were pushed.
+ *
+ */
+class JobHeap
+{
+    private:
+        static const size_t ARITY = 4;
+
+        struct Entry
+        {
+            Job job;
+            unsigned long seq;
+        };
+
+        std::vector<Entry> entries;
+        unsigned long seqCounter;
+
+        bool before( const Entry &a, const Entry &b ) const;
+        void siftUp( size_t index );
+        void siftDown( size_t index );
+
+    public:
+        JobHeap();
+
+        /**
+         * @brief Checks whether heap is empty.
+         */
+        bool Empty( ) const;
+
+        /**
+         * @brief Returns number of queued jobs.
+         */
+        size_t Size( ) const;
+
+        /**
+         * @brief Queues job.
+         *
+         * @param job Job to queue, lower key pops first.
+         */
+        void Push( const Job &job );
+
+        /**
+         * @brief Returns job with lowest key. Heap must not be empty.
+         */
+        const Job &Top( ) const;
+
+        /**
+         * @brief Removes job with lowest key. Heap must not be empty.
+         */
+        void Pop( );
+
+        /**
+         * @brief Removes every job.
+         */
+        void Clear( );
+};
+
+#endif // _JOB_HEAP
@@ -0,0 +1,71 @@
+#ifndef _LOG_FILTER
+#define _LOG_FILTER
+
+/**
+ * @brief Part of the simulation a log statement belongs to.
+ *
+ */
+enum class LogCategory : unsigned int {
+    OS,         // Simulator start and end, process creation, logger
+    PROCESS,    // Processing actions and process completion
+    MEMORY,     // Memory actions, page faults and memory statistics
+    DEVICE,     // IO actions
+    SCHEDULER,  // Dispatches and scheduling statistics
+    COUNT
+};
+
+/**
+ * @brief Detail of a log statement, every level includes the ones before it.
+ *
+ */
+enum class LogLevel : unsigned int {
+    NONE,       // Nothing is logged
+    SUMMARY,    // Simulator start and end, statistics at the end of the run
+    INFO,       // Process creation, completion and termination
+    DETAIL      // Every action of every process
+};
+
+// Compile-time filter, e.g. -DSIM_LOG_LEVEL=0 compiles every log statement out
+#ifndef SIM_LOG_LEVEL
+#define SIM_LOG_LEVEL 3
+#endif
+
+// Bit of every LogCategory compiled in
+#ifndef SIM_LOG_CATEGORIES
+#define SIM_LOG_CATEGORIES 0x1F
+#endif
+
+/**
+ * @brief Returns whether log statements of category and level are compiled in.
+ */
+constexpr bool LogCompiled( LogCategory category, LogLevel level )
+{
+    return (unsigned int)level <= SIM_LOG_LEVEL && ((SIM_LOG_CATEGORIES >> (unsigned int)category) & 1);
+}
+
+/**
+ * @brief LogCompiled as a constant expression, so the test folds away even
+ *        in unoptimized builds.
+ */
+template<LogCategory category, LogLevel level>
+struct LogCompiledFlag
+{
+    static const bool value = LogCompiled( category, level );
+};
+
+/**
+ * @brief Runs log statement on sim if its category and level are enabled.
+ * @details Statements compiled out are removed by the compiler, statements
+ *          disabled by config cost one test. Either way arguments of the
+ *          statement, simTime() included, are not evaluated.
+ *
+ *          SIM_LOG( this, PROCESS, DETAIL, trace( TraceEvent::PROC_START, pid, core ) );
+ */
+#define SIM_LOG( sim, category, level, ... )                                            \
+    do {                                                                                \
+        if( LogCompiledFlag<LogCategory::category, LogLevel::level>::value              \
+            && (sim)->LogEnabled( LogCategory::category, LogLevel::level ) )            \
+            (sim)->__VA_ARGS__;                                                         \
+    } while( 0 )
+
+#endif // _LOG_FILTER
@@ -0,0 +1,344 @@
+#include "MemoryManager.h"
+
+#include <cstring>
+#include <algorithm>
+
+static const uint64_t ALL_SET = ~0ULL;
+
+MemoryManager::MemoryManager()
+{
+    Reset( 0, 0 );
+}
+
+void MemoryManager::Reset( unsigned long blocks, unsigned long now )
+{
+    size_t words = (blocks + 63) / 64;
+    used.assign( words, 0 );
+    full.assign( (words + 63) / 64, 0 );
+    empty.assign( (words + 63) / 64, ALL_SET );
+    owned.clear();
+    cursor = 0;
+    freedSinceMeasure = 0;
+
+    // Blocks past the end of memory are never free
+    if( blocks % 64 )
+    {
+        used[words - 1] = ALL_SET << (blocks % 64);
+        empty[(words - 1) / 64] &= ~(1ULL << ((words - 1) % 64));
+    }
+
+    memset( &stats, 0, sizeof stats );
+    stats.totalBlocks = blocks;
+    startTime = now;
+    lastTime = now;
+    usedIntegral = 0;
+    measure();
+}
+
+void MemoryManager::advance( unsigned long now )
+{
+    if( now > lastTime )
+    {
+        usedIntegral += (double)stats.usedBlocks * (now - lastTime);
+        lastTime = now;
+    }
+}
+
+void MemoryManager::measure( )
+{
+    unsigned long run = 0;
+    stats.largestFree = 0;
+    stats.freeExtents = 0;
+    for( size_t w = 0; w < used.size(); ++w )
+    {
+        uint64_t freeBits = ~used[w];
+        if( freeBits == ALL_SET )
+        {
+            stats.freeExtents += run == 0;
+            run += 64;
+            continue;
+        }
+
+        // Every free bit above a used one starts a run, bit 0 does unless carried
+        uint64_t starts = freeBits & ~(freeBits << 1);
+        stats.freeExtents += __builtin_popcountll( starts ) - (run && (freeBits & 1));
+
+        unsigned long low = __builtin_ctzll( ~freeBits );
+        stats.largestFree = std::max( stats.largestFree, run + low );
+        for( uint64_t rest = freeBits >> low; rest; )
+        {
+            unsigned int gap = __builtin_ctzll( rest );
+            rest >>= gap;
+            unsigned int length = ~rest ? __builtin_ctzll( ~rest ) : 64;
+            stats.largestFree = std::max<unsigned long>( stats.largestFree, length );
+            rest = length < 64 ? rest >> length : 0;
+        }
+        run = __builtin_clzll( ~freeBits );
+    }
+    stats.largestFree = std::max( stats.largestFree, run );
+
+    unsigned long freeBlocks = stats.totalBlocks - stats.usedBlocks;
+    stats.fragmentation = freeBlocks ? 1.0 - (double)stats.largestFree / freeBlocks : 0.0;
+    if( stats.fragmentation > stats.maxFragmentation )
+        stats.maxFragmentation = stats.fragmentation;
+    freedSinceMeasure = 0;
+}
+
+unsigned long MemoryManager::freeRunAround( unsigned long start, unsigned long blocks ) const
+{
+    // Free blocks right below start
+    size_t w = start / 64;
+    unsigned int bit = start % 64;
+    unsigned long below = 0;
+    bool open = true;
+    if( bit )
+    {
+        uint64_t usedBelow = used[w] << (64 - bit);
+        open = usedBelow == 0;
+        below = open ? bit : __builtin_clzll( usedBelow );
+    }
+    while( open && w > 0 )
+    {
+        if( w % 64 == 0 && empty[w / 64 - 1] == ALL_SET )
+        {
+            below += 64 * 64;
+            w -= 64;
+            continue;
+        }
+        --w;
+        if( used[w] )
+        {
+            below += __builtin_clzll( used[w] );
+            break;
+        }
+        below += 64;
+    }
+
+    // Free blocks right above the end, blocks past the end of memory are used
+    unsigned long end = start + blocks;
+    w = end / 64;
+    bit = end % 64;
+    unsigned long above = 0;
+    open = true;
+    if( bit )
+    {
+        uint64_t usedAbove = used[w] >> bit;
+        open = usedAbove == 0;
+        above = open ? 64 - bit : __builtin_ctzll( usedAbove );
+        w += open;
+    }
+    while( open && w < used.size() )
+    {
+        if( w % 64 == 0 && w + 64 <= used.size() && empty[w / 64] == ALL_SET )
+        {
+            above += 64 * 64;
+            w += 64;
+            continue;
+        }
+        if( used[w] )
+        {
+            above += __builtin_ctzll( used[w] );
+            break;
+        }
+        above += 64;
+        ++w;
+    }
+    return below + blocks + above;
+}
+
+bool MemoryManager::findLargeRun( size_t from, size_t to, unsigned long blocks, unsigned long &start ) const
+{
+    size_t w = from;
+    while( w < to )
+    {
+        // Next empty word, 64 words at a time through the summary
+        uint64_t bits = empty[w / 64] & (ALL_SET << (w % 64));
+        if( !bits )
+        {
+            w = (w | 63) + 1;
+            continue;
+        }
+        w = (w & ~(size_t)63) + __builtin_ctzll( bits );
+        if( w >= to )
+            break;
+
+        // Extend over free top of the word before and the empty words after
+        unsigned long back = 0;
+        if( w > 0 )
+            back = used[w - 1] ? __builtin_clzll( used[w - 1] ) : 64;
+        size_t end = w;
+        while( end < used.size() && used[end] == 0 && back + (end - w) * 64 < blocks )
+            ++end;
+        unsigned long length = back + (end - w) * 64;
+        if( length < blocks && end < used.size() )
+            length += __builtin_ctzll( used[end] );
+        if( length >= blocks )
+        {
+            start = w * 64 - back;
+            return true;
+        }
+        w = end + 1;
+    }
+    return false;
+}
+
+bool MemoryManager::findRun( size_t from, size_t to, unsigned long blocks, unsigned long &start ) const
+{
+    if( blocks >= 128 )
+        return findLargeRun( from, to, blocks, start );
+
+    unsigned long run = 0; // Free blocks at the top of previous words
+    for( size_t w = from; w < to; ++w )
+    {
+        // Skip 64 full words at once while no run is open
+        if( run == 0 && (w & 63) == 0 && full[w >> 6] == ALL_SET )
+        {
+            w += 63;
+            continue;
+        }
+
+        uint64_t freeBits = ~used[w];
+        if( freeBits == ALL_SET )
+        {
+            if( run + 64 >= blocks )
+            {
+                start = w * 64 - run;
+                return true;
+            }
+            run += 64;
+            continue;
+        }
+        if( freeBits == 0 )
+        {
+            run = 0;
+            continue;
+        }
+
+        // Run from previous words ending in this one
+        if( run && run + __builtin_ctzll( ~freeBits ) >= blocks )
+        {
+            start = w * 64 - run;
+            return true;
+        }
+
+        // Run within the word, starts has bit i set if i..i+length-1 are free
+        if( blocks <= 64 )
+        {
+            uint64_t starts = freeBits;
+            unsigned long length = 1;
+            while( length < blocks && starts )
+            {
+                unsigned long shift = std::min( length, blocks - length );
+                starts &= starts >> shift;
+                length += shift;
+            }
+            if( starts )
+            {
+                start = w * 64 + __builtin_ctzll( starts );
+                return true;
+            }
+        }
+
+        run = __builtin_clzll( ~freeBits );
+    }
+    return false;
+}
+
+void MemoryManager::mark( unsigned long start, unsigned long blocks, bool value )
+{
+    unsigned long end = start + blocks;
+    while( start < end )
+    {
+        size_t w = start / 64;
+        unsigned int offset = start % 64;
+        unsigned long count = std::min<unsigned long>( 64 - offset, end - start );
+        uint64_t mask = (count == 64 ? ALL_SET : ((1ULL << count) - 1)) << offset;
+        if( value )
+            used[w] |= mask;
+        else
+            used[w] &= ~mask;
+
+        uint64_t bit = 1ULL << (w % 64);
+        if( used[w] == ALL_SET )
+            full[w / 64] |= bit;
+        else
+            full[w / 64] &= ~bit;
+        if( used[w] == 0 )
+            empty[w / 64] |= bit;
+        else
+            empty[w / 64] &= ~bit;
+        start += count;
+    }
+}
+
+bool MemoryManager::Allocate( unsigned int pid, unsigned long blocks, unsigned long now, unsigned long &start )
+{
+    advance( now );
+
+    // Next-fit, search from the cursor to the end, then from the start up
+    // to past the cursor so runs crossing it are found too. Allocating
+    // never makes a free run larger, so largestFree from the last measure,
+    // free or failed search bounds what can be found
+    size_t from = cursor / 64;
+    size_t to = std::min( used.size(), from + blocks / 64 + 2 );
+    if( blocks > stats.largestFree ||
+        (!findRun( from, used.size(), blocks, start ) && !findRun( 0, to, blocks, start )) )
+    {
+        if( blocks <= stats.largestFree )
+            stats.largestFree = blocks - 1;
+        ++stats.failures;
+        return false;
+    }
+
+    mark( start, blocks, true );
+    if( pid >= owned.size() )
+        owned.resize( pid * 2 + 1 );
+    owned[pid].push_back( Extent{start, blocks} );
+    cursor = start + blocks;
+    if( cursor >= stats.totalBlocks )
+        cursor = 0;
+
+    ++stats.allocations;
+    stats.usedBlocks += blocks;
+    if( stats.usedBlocks > stats.peakBlocks )
+        stats.peakBlocks = stats.usedBlocks;
+    return true;
+}
+
+unsigned long MemoryManager::FreeAll( unsigned int pid, unsigned long now )
+{
+    if( pid >= owned.size() || owned[pid].empty() )
+        return 0;
+
+    // Extent list keeps its capacity for the next process with this PID
+    advance( now );
+    unsigned long before = stats.usedBlocks;
+    for( const Extent &extent : owned[pid] )
+    {
+        mark( extent.start, extent.blocks, false );
+        stats.usedBlocks -= extent.blocks;
+    }
+    stats.frees += owned[pid].size();
+
+    // Free runs that grew all hold a freed extent, so largestFree stays a
+    // bound without scanning the bitmap. Full scan is sampled once as many
+    // blocks are freed as memory has, a word scanned per 64 blocks freed
+    for( const Extent &extent : owned[pid] )
+        stats.largestFree = std::max( stats.largestFree, freeRunAround( extent.start, extent.blocks ) );
+    owned[pid].clear();
+    freedSinceMeasure += before - stats.usedBlocks;
+    if( freedSinceMeasure >= stats.totalBlocks )
+        measure();
+    return before - stats.usedBlocks;
+}
+
+MemoryStats MemoryManager::Stats( unsigned long now )
+{
+    advance( now );
+    measure();
+    MemoryStats result = stats;
+    unsigned long elapsed = lastTime - startTime;
+    if( stats.totalBlocks )
+        result.avgUtilization = elapsed ? usedIntegral / elapsed / stats.totalBlocks : (double)stats.usedBlocks / stats.totalBlocks;
+    return result;
+}
@@ -0,0 +1,137 @@
+#ifndef _MEMORY_MANAGER
+#define _MEMORY_MANAGER
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Utilization and fragmentation of simulated memory.
+ * @details Utilization average is weighted by time. Fragmentation is
+ *          1 - largest free extent / free blocks, 0 when memory is full
+ *          or free memory is in one piece. Its maximum is sampled as memory
+ *          is freed, once per as many blocks freed as memory has.
+ *
+ */
+struct MemoryStats
+{
+    unsigned long allocations;
+    unsigned long failures;
+    unsigned long frees;
+    unsigned long totalBlocks;
+    unsigned long usedBlocks;
+    unsigned long peakBlocks;
+    unsigned long largestFree;
+    unsigned long freeExtents;
+    double avgUtilization;
+    double fragmentation;
+    double maxFragmentation;
+};
+
+/**
+ * @brief Allocator of simulated memory blocks.
+ * @details Blocks are tracked in a bitmap, one bit per block, with
+ *          summary bitmaps marking words of the bitmap that are full and
+ *          that are empty. Free runs are searched a 64-bit word at a time
+ *          and full words are skipped 64 at a time through the summary.
+ *          Runs of 128 blocks or more always hold an empty word, they are
+ *          searched from empty words only. Allocation is
+ *          next-fit, search starts at the word where the previous
+ *          allocation ended. Every allocation is owned by a PID and all of
+ *          it can be freed at once. Not thread-safe.
+ *
+ */
+class MemoryManager
+{
+    private:
+        struct Extent
+        {
+            unsigned long start;
+            unsigned long blocks;
+        };
+
+        std::vector<uint64_t> used;     // Bit set for every used block
+        std::vector<uint64_t> full;     // Bit set for every full word of used
+        std::vector<uint64_t> empty;    // Bit set for every empty word of used
+        std::vector< std::vector<Extent> > owned;      // Extents by PID
+        unsigned long cursor;
+        unsigned long freedSinceMeasure;    // Blocks freed since last measure
+
+        MemoryStats stats;
+        unsigned long lastTime;
+        double usedIntegral;
+        unsigned long startTime;
+
+        /**
+         * @brief Finds first run of free blocks starting in words from to to.
+         * @return False if there is none.
+         */
+        bool findRun( size_t from, size_t to, unsigned long blocks, unsigned long &start ) const;
+
+        /**
+         * @brief Finds first run of at least 128 free blocks holding an
+         *        empty word from from to to.
+         * @return False if there is none.
+         */
+        bool findLargeRun( size_t from, size_t to, unsigned long blocks, unsigned long &start ) const;
+
+        /**
+         * @brief Marks blocks used or free.
+         */
+        void mark( unsigned long start, unsigned long blocks, bool value );
+
+        /**
+         * @brief Accounts time since last change at current utilization.
+         */
+        void advance( unsigned long now );
+
+        /**
+         * @brief Returns length of free run holding free blocks start to start + blocks.
+         * @details Empty words around it are skipped 64 at a time through the summary.
+         */
+        unsigned long freeRunAround( unsigned long start, unsigned long blocks ) const;
+
+        /**
+         * @brief Scans bitmap for largest free run and fragmentation.
+         * @details Linear in memory size, done when stats are read and as a
+         *          sample once enough blocks are freed to pay for it, never
+         *          on allocation.
+         */
+        void measure( );
+
+    public:
+        MemoryManager();
+
+        /**
+         * @brief Frees everything and sets size of memory.
+         *
+         * @param blocks Number of blocks in memory.
+         * @param now Current simulation time in ms.
+         */
+        void Reset( unsigned long blocks, unsigned long now );
+
+        /**
+         * @brief Allocates consecutive blocks for process.
+         *
+         * @param pid Owner of allocated blocks.
+         * @param blocks Number of blocks, at least 1.
+         * @param now Current simulation time in ms.
+         * @param start First allocated block.
+         * @return False if there is no free extent large enough.
+         */
+        bool Allocate( unsigned int pid, unsigned long blocks, unsigned long now, unsigned long &start );
+
+        /**
+         * @brief Frees all blocks owned by process.
+         *
+         * @return Number of blocks freed.
+         */
+        unsigned long FreeAll( unsigned int pid, unsigned long now );
+
+        /**
+         * @brief Returns stats, utilization averaged up to now.
+         */
+        MemoryStats Stats( unsigned long now );
+};
+
+#endif // _MEMORY_MANAGER
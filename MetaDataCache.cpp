@@ -0,0 +1,172 @@
+#include "MetaDataCache.h"
+#include "Program.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+static const size_t WRITE_BATCH = 4096;    // Events written at once
+
+MetaDataCache::MetaDataCache( ) : data( NULL ), size( 0 ), header( NULL ), programs( NULL ), events( NULL )
+{
+}
+
+MetaDataCache::~MetaDataCache( )
+{
+    Close();
+}
+
+string MetaDataCache::PathOf( const string &mdFile )
+{
+    size_t length = mdFile.size();
+    if( length >= 4 && mdFile.compare( length - 4, 4, ".mdf" ) == 0 )
+        return mdFile.substr( 0, length - 4 ) + ".mdb";
+    return mdFile + ".mdb";
+}
+
+bool MetaDataCache::Open( const string &path, uint64_t sourceSize, uint64_t sourceHash )
+{
+    Close();
+
+    int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if( fd < 0 )
+        return false;
+
+    struct stat st;
+    if( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) || (size_t)st.st_size < sizeof(MetaDataCacheHeader) )
+    {
+        close( fd );
+        return false;
+    }
+    void *mapped = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( mapped == MAP_FAILED )
+        return false;
+    data = (const char *)mapped;
+    size = st.st_size;
+
+    // Stale or foreign cache is not used
+    header = (const MetaDataCacheHeader *)data;
+    if( memcmp( header->magic, MDB_MAGIC, sizeof header->magic ) != 0
+        || header->version != MDB_VERSION
+        || header->eventSize != sizeof(SimEvent)
+        || header->sourceSize != sourceSize
+        || header->sourceHash != sourceHash )
+    {
+        Close();
+        return false;
+    }
+
+    // Sections must fill the file exactly, every program within the events
+    uint64_t available = size - sizeof(MetaDataCacheHeader);
+    if( header->programCount > available / sizeof(MetaDataCacheProgram)
+        || header->eventCount != (available - header->programCount * sizeof(MetaDataCacheProgram)) / sizeof(SimEvent)
+        || available != header->programCount * sizeof(MetaDataCacheProgram) + header->eventCount * sizeof(SimEvent) )
+    {
+        Close();
+        return false;
+    }
+    programs = (const MetaDataCacheProgram *)(data + sizeof(MetaDataCacheHeader));
+    events = (const SimEvent *)(programs + header->programCount);
+    for( uint64_t i = 0; i < header->programCount; ++i )
+    {
+        if( programs[i].firstEvent > header->eventCount
+            || programs[i].eventCount > header->eventCount - programs[i].firstEvent )
+        {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void MetaDataCache::Close( )
+{
+    if( data )
+        munmap( (void *)data, size );
+    data = NULL;
+    size = 0;
+    header = NULL;
+    programs = NULL;
+    events = NULL;
+}
+
+size_t MetaDataCache::ProgramCount( ) const
+{
+    return header ? header->programCount : 0;
+}
+
+const MetaDataCacheProgram &MetaDataCache::Entry( size_t index ) const
+{
+    return programs[index];
+}
+
+const SimEvent *MetaDataCache::Events( const MetaDataCacheProgram &program ) const
+{
+    return events + program.firstEvent;
+}
+
+bool MetaDataCache::Write( const string &path, uint64_t sourceSize, uint64_t sourceHash,
+    const vector<Program *> &programs )
+{
+    MetaDataCacheHeader header;
+    memcpy( header.magic, MDB_MAGIC, sizeof header.magic );
+    header.version = MDB_VERSION;
+    header.eventSize = sizeof(SimEvent);
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    header.programCount = programs.size();
+    header.eventCount = 0;
+
+    vector<MetaDataCacheProgram> entries( programs.size() );
+    for( size_t i = 0; i < programs.size(); ++i )
+    {
+        MetaDataCacheProgram &entry = entries[i];
+        entry.firstEvent = header.eventCount;
+        entry.eventCount = programs[i]->eventCount;
+        header.eventCount += entry.eventCount;
+    }
+
+    string temporary = path + ".tmp";
+    FILE *file = fopen( temporary.c_str(), "wb" );
+    if( !file )
+        return false;
+    bool written = fwrite( &header, sizeof header, 1, file ) == 1
+        && fwrite( entries.data(), sizeof(MetaDataCacheProgram), entries.size(), file ) == entries.size();
+
+    // Events are copied field by field so padding in the file is zero
+    vector<SimEvent> buffer;
+    buffer.reserve( WRITE_BATCH );
+    for( size_t i = 0; written && i < programs.size(); ++i )
+    {
+        for( size_t j = 0; j < programs[i]->eventCount; ++j )
+        {
+            const SimEvent &event = programs[i]->eventData[j];
+            buffer.emplace_back();
+            memset( &buffer.back(), 0, sizeof(SimEvent) );
+            buffer.back().code = event.code;
+            buffer.back().descriptor = event.descriptor;
+            buffer.back().cycles = event.cycles;
+            if( buffer.size() == WRITE_BATCH )
+            {
+                written = fwrite( buffer.data(), sizeof(SimEvent), buffer.size(), file ) == buffer.size();
+                buffer.clear();
+            }
+        }
+    }
+    written = written && fwrite( buffer.data(), sizeof(SimEvent), buffer.size(), file ) == buffer.size();
+    written = fclose( file ) == 0 && written;
+    if( !written || rename( temporary.c_str(), path.c_str() ) != 0 )
+    {
+        unlink( temporary.c_str() );
+        return false;
+    }
+    return true;
+}
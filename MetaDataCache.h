@@ -0,0 +1,112 @@
+#ifndef _META_DATA_CACHE
+#define _META_DATA_CACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Program;
+struct SimEvent;
+
+/**
+ * @brief Header at the start of meta-data cache file.
+ *
+ */
+struct MetaDataCacheHeader
+{
+    char magic[8];              // MDB_MAGIC
+    uint32_t version;
+    uint32_t eventSize;         // sizeof(SimEvent) of the writer
+    uint64_t sourceSize;        // Size of meta-data file cached
+    uint64_t sourceHash;        // MetaDataParser::Hash of meta-data file cached
+    uint64_t programCount;
+    uint64_t eventCount;
+};
+
+/**
+ * @brief Program in meta-data cache, its events are a range of the event array.
+ * @details Work time depends on cycle times of the config, it is not
+ *          cached but summed again when the program is loaded.
+ *
+ */
+struct MetaDataCacheProgram
+{
+    uint64_t firstEvent;
+    uint64_t eventCount;
+};
+
+const char MDB_MAGIC[8] = { 'S', 'I', 'M', 'M', 'D', 'B', '\0', '\0' };
+const uint32_t MDB_VERSION = 1;
+
+/**
+ * @brief Parsed and validated meta-data saved next to the meta-data file.
+ * @details File is the header, the programs and then events of all
+ *          programs, as SimEvent is laid out in memory. It is mapped with
+ *          a single mmap and used only if it was written from a meta-data
+ *          file of the same size and hash.
+ *
+ */
+class MetaDataCache
+{
+    private:
+        const char *data;
+        size_t size;
+        const MetaDataCacheHeader *header;
+        const MetaDataCacheProgram *programs;
+        const SimEvent *events;
+
+    public:
+        MetaDataCache( );
+        ~MetaDataCache( );
+
+        MetaDataCache( const MetaDataCache & ) = delete;
+        MetaDataCache &operator=( const MetaDataCache & ) = delete;
+
+        /**
+         * @brief Returns path of cache of meta-data file, its .mdf extension replaced by .mdb.
+         */
+        static std::string PathOf( const std::string &mdFile );
+
+        /**
+         * @brief Maps cache file and checks it was written from the meta-data file.
+         *
+         * @param path Path of the cache.
+         * @param sourceSize Size of the meta-data file.
+         * @param sourceHash MetaDataParser::Hash of the meta-data file.
+         * @return False if there is no cache, or it is stale or malformed.
+         */
+        bool Open( const std::string &path, uint64_t sourceSize, uint64_t sourceHash );
+
+        /**
+         * @brief Unmaps the cache.
+         */
+        void Close( );
+
+        /**
+         * @brief Returns number of programs in the cache.
+         */
+        size_t ProgramCount( ) const;
+
+        /**
+         * @brief Returns program of the cache.
+         */
+        const MetaDataCacheProgram &Entry( size_t index ) const;
+
+        /**
+         * @brief Returns first event of program, the cache must stay open while it is used.
+         */
+        const SimEvent *Events( const MetaDataCacheProgram &program ) const;
+
+        /**
+         * @brief Writes cache of programs read from the meta-data file.
+         * @details Cache is written to a temporary file renamed over path,
+         *          so a run never maps a partly written cache.
+         *
+         * @return False if the cache could not be written.
+         */
+        static bool Write( const std::string &path, uint64_t sourceSize, uint64_t sourceHash,
+            const std::vector<Program *> &programs );
+};
+
+#endif // _META_DATA_CACHE
@@ -0,0 +1,339 @@
+#include "MetaDataParser.h"
+
+#include <climits>
+#include <cstring>
+#include <exception>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::string_view;
+
+static const string_view mdHeader = "Start Program Meta-Data Code:";
+static const string_view mdFooter = "End Program Meta-Data Code.";
+
+// White space trimmed from meta-data lines
+static inline bool isTrimSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// White space allowed inside an event, \s of the event grammar
+static inline bool isEventSpace( char c )
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static string_view trim( string_view str )
+{
+    size_t leftPos = 0;
+    size_t rightPos = str.size();
+    while( leftPos < rightPos && isTrimSpace( str[leftPos] ) )
+        ++leftPos;
+    while( rightPos > leftPos && isTrimSpace( str[rightPos-1] ) )
+        --rightPos;
+    return str.substr( leftPos, rightPos - leftPos );
+}
+
+// Reads next line from pos trimmed, false at the end
+static bool nextLine( const char *&pos, const char *end, string_view &line )
+{
+    if( pos == end )
+        return false;
+    const char *eol = (const char *)memchr( pos, '\n', end - pos );
+    if( !eol )
+        eol = end;
+    line = trim( string_view( pos, eol - pos ) );
+    pos = eol == end ? end : eol + 1;
+    return true;
+}
+
+// Joins part of event to pending part, which is in the mapping or in joined
+static string_view join( string_view pending, string &joined, string_view part )
+{
+    if( pending.empty() )
+        return part;
+    if( part.empty() )
+        return pending;
+    if( pending.data() != joined.data() )
+        joined.assign( pending.data(), pending.size() );
+    joined.append( part.data(), part.size() );
+    return string_view( joined );
+}
+
+MetaDataParser::MetaDataParser( ) : data( NULL ), size( 0 )
+{
+}
+
+MetaDataParser::~MetaDataParser( )
+{
+    Close();
+}
+
+bool MetaDataParser::Open( const string &path )
+{
+    Close();
+
+    int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if( fd < 0 )
+        return false;
+
+    struct stat st;
+    if( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) )
+    {
+        close( fd );
+        return false;
+    }
+
+    // Empty file can't be mapped, it is parsed as no lines
+    if( st.st_size > 0 )
+    {
+        void *mapped = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( mapped == MAP_FAILED )
+        {
+            close( fd );
+            return false;
+        }
+        madvise( mapped, st.st_size, MADV_SEQUENTIAL );
+        data = (const char *)mapped;
+        size = st.st_size;
+    }
+    close( fd );
+    return true;
+}
+
+void MetaDataParser::Close( )
+{
+    if( data )
+        munmap( (void *)data, size );
+    data = NULL;
+    size = 0;
+}
+
+bool MetaDataParser::ParseEvent( string_view event, char &code, string_view &descriptor, long int &cycles )
+{
+    size_t i = 0;
+    size_t n = event.size();
+    auto skipSpace = [&]{ while( i < n && isEventSpace( event[i] ) ) ++i; };
+
+    skipSpace();
+    if( i == n || event[i] < 'A' || event[i] > 'Z' )
+        return false;
+    code = event[i++];
+
+    skipSpace();
+    if( i == n || event[i] != '(' )
+        return false;
+    ++i;
+
+    skipSpace();
+    size_t start = i;
+    while( i < n && ((event[i] >= 'a' && event[i] <= 'z') || isEventSpace( event[i] )) )
+        ++i;
+    descriptor = event.substr( start, i - start );
+    if( i == n || event[i] != ')' )
+        return false;
+    ++i;
+
+    skipSpace();
+    if( i == n || event[i] < '0' || event[i] > '9' )
+        return false;
+    cycles = 0;
+    for( ; i < n && event[i] >= '0' && event[i] <= '9'; ++i )
+    {
+        long int digit = event[i] - '0';
+        cycles = cycles > (LONG_MAX - digit) / 10 ? LONG_MAX : cycles * 10 + digit;
+    }
+
+    skipSpace();
+    return i == n;
+}
+
+void MetaDataParser::Parse( const EventHandler &handler ) const
+{
+    const char *pos = data;
+    const char *end = data + size;
+
+    auto parseEvent = [&]( string_view event )
+    {
+        char code;
+        string_view descriptor;
+        long int cycles;
+        if( !ParseEvent( event, code, descriptor, cycles ) )
+            throw MetaDataError( "Unable to parse following event: " + string( event ) );
+        handler( code, descriptor, cycles );
+    };
+
+    // Header has to be the first line
+    string_view line;
+    if( !nextLine( pos, end, line ) || line != mdHeader )
+        throw MetaDataError( "Meta-Data header is missing!" );
+
+    string_view pending;        // Event after the last ';' so far, in the mapping or in joined
+    string joined;              // Event spanning lines
+    char last = '\0';           // Last character of meta-data
+    bool footer = false;
+    std::exception_ptr error;
+
+    while( nextLine( pos, end, line ) )
+    {
+        if( line == mdFooter )
+        {
+            footer = true;
+            break;
+        }
+        if( line.empty() )
+            continue;
+        last = line.back();
+
+        // After an error only the footer is looked for
+        if( error )
+            continue;
+        try
+        {
+            size_t start = 0;
+            size_t semicolon;
+            while( (semicolon = line.find( ';', start )) != string_view::npos )
+            {
+                parseEvent( join( pending, joined, line.substr( start, semicolon - start ) ) );
+                pending = string_view();
+                start = semicolon + 1;
+            }
+            pending = join( pending, joined, line.substr( start ) );
+        }
+        catch( ... )
+        {
+            error = std::current_exception();
+        }
+    }
+
+    if( !footer )
+        throw MetaDataError( "Meta-Data footer is missing!" );
+    if( last != '.' )
+        throw MetaDataError( "Meta-Data is missing period at the end of events!" );
+    if( error )
+        std::rethrow_exception( error );
+
+    // Last event ends with the period
+    parseEvent( pending.substr( 0, pending.size() - 1 ) );
+}
+
+size_t MetaDataParser::Body( ) const
+{
+    const char *pos = data;
+    string_view line;
+    if( !nextLine( pos, data + size, line ) || line != mdHeader )
+        return string::npos;
+    return pos - data;
+}
+
+size_t MetaDataParser::LineStart( size_t offset ) const
+{
+    if( offset == 0 || offset >= size || data[offset-1] == '\n' )
+        return offset < size ? offset : size;
+    const char *eol = (const char *)memchr( data + offset, '\n', size - offset );
+    return eol ? eol + 1 - data : size;
+}
+
+void MetaDataParser::ParseChunk( size_t begin, size_t end, const EventHandler &handler, MetaDataChunk &chunk ) const
+{
+    chunk.leading.clear();
+    chunk.trailing.clear();
+    chunk.separated = false;
+    chunk.footer = false;
+    chunk.last = '\0';
+    chunk.failed = false;
+
+    const char *pos = data + begin;
+    const char *stop = data + end;
+    string_view line;
+    string_view pending;
+    string joined;
+
+    // Lines starting in the chunk end in it, end is a line start
+    while( pos < stop && nextLine( pos, data + size, line ) )
+    {
+        if( line == mdFooter )
+        {
+            chunk.footer = true;
+            break;
+        }
+        if( line.empty() )
+            continue;
+        chunk.last = line.back();
+
+        size_t start = 0;
+        size_t semicolon;
+        while( (semicolon = line.find( ';', start )) != string_view::npos )
+        {
+            string_view event = join( pending, joined, line.substr( start, semicolon - start ) );
+            if( !chunk.separated )
+            {
+                chunk.leading.assign( event.data(), event.size() );
+                chunk.separated = true;
+            }
+            else
+            {
+                char code;
+                string_view descriptor;
+                long int cycles;
+                if( !ParseEvent( event, code, descriptor, cycles ) )
+                {
+                    chunk.failed = true;
+                    return;
+                }
+                try
+                {
+                    handler( code, descriptor, cycles );
+                }
+                catch( ... )
+                {
+                    chunk.failed = true;
+                    return;
+                }
+            }
+            pending = string_view();
+            start = semicolon + 1;
+        }
+        pending = join( pending, joined, line.substr( start ) );
+    }
+
+    if( chunk.separated )
+        chunk.trailing.assign( pending.data(), pending.size() );
+    else
+        chunk.leading.assign( pending.data(), pending.size() );
+}
+
+uint64_t MetaDataParser::Hash( ) const
+{
+    // Four independent lanes of multiply and rotate, 32 bytes per round
+    const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+    auto round = []( uint64_t lane, uint64_t word ) {
+        lane += word * prime2;
+        lane = (lane << 31) | (lane >> 33);
+        return lane * prime1;
+    };
+
+    uint64_t lanes[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+    size_t pos = 0;
+    for( ; pos + 32 <= size; pos += 32 )
+    {
+        uint64_t words[4];
+        memcpy( words, data + pos, sizeof words );
+        for( int i = 0; i < 4; ++i )
+            lanes[i] = round( lanes[i], words[i] );
+    }
+
+    uint64_t hash = size;
+    for( int i = 0; i < 4; ++i )
+        hash = round( hash ^ round( 0, lanes[i] ), 0 );
+    for( ; pos < size; ++pos )
+        hash = round( hash, (unsigned char)data[pos] );
+    hash ^= hash >> 29;
+    hash *= prime2;
+    return hash ^ (hash >> 32);
+}
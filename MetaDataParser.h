@@ -0,0 +1,135 @@
+#ifndef _META_DATA_PARSER
+#define _META_DATA_PARSER
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Malformed meta-data, message is the one reported to the user.
+ *
+ */
+class MetaDataError : public std::runtime_error
+{
+    public:
+        using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief What MetaDataParser found in a chunk of meta-data.
+ * @details Events are split by ';', so the text before the first and
+ *          after the last ';' of a chunk belong to events shared with
+ *          neighbouring chunks, they are returned joined instead of parsed.
+ *
+ */
+struct MetaDataChunk
+{
+    std::string leading;    // Text before the first ';', all text if there is none
+    std::string trailing;   // Text after the last ';'
+    bool separated;         // Chunk has a ';'
+    bool footer;            // Chunk ends with the footer
+    char last;              // Last character of meta-data in chunk, '\0' for none
+    bool failed;            // Event did not parse or handler threw
+};
+
+/**
+ * @brief Single-pass meta-data parser over a memory-mapped file.
+ * @details The file is mapped read-only and scanned once, line by line,
+ *          every event is handed to the handler as views into the mapping
+ *          without copying it. Meta-data has the same meaning as when
+ *          lines between header and footer are trimmed, joined and split
+ *          on ';': events may span lines, only an event that does is
+ *          copied to join its parts.
+ *
+ *          Errors are reported as they would be if the whole meta-data was
+ *          checked for header, footer and period before any event is read.
+ *          Error of an event, the parser's or the handler's, is held until
+ *          the footer is found and then rethrown.
+ *
+ */
+class MetaDataParser
+{
+    private:
+        const char *data;
+        size_t size;
+
+    public:
+        /**
+         * @brief Handler of one event, descriptor is only valid during the call.
+         */
+        typedef std::function<void( char code, std::string_view descriptor, long int cycles )> EventHandler;
+
+        MetaDataParser( );
+        ~MetaDataParser( );
+
+        MetaDataParser( const MetaDataParser & ) = delete;
+        MetaDataParser &operator=( const MetaDataParser & ) = delete;
+
+        /**
+         * @brief Maps meta-data file into memory.
+         *
+         * @param path Path of the file.
+         * @return False if the file could not be opened or mapped.
+         */
+        bool Open( const std::string &path );
+
+        /**
+         * @brief Unmaps the file.
+         */
+        void Close( );
+
+        /**
+         * @brief Parses every event between header and footer and passes it to handler.
+         * @details Throws MetaDataError on malformed meta-data, exceptions of
+         *          handler are passed on.
+         */
+        void Parse( const EventHandler &handler ) const;
+
+        /**
+         * @brief Returns offset of the line after the header, npos if the header is missing.
+         */
+        size_t Body( ) const;
+
+        /**
+         * @brief Returns offset of the first line starting at or after offset.
+         */
+        size_t LineStart( size_t offset ) const;
+
+        /**
+         * @brief Parses events of lines starting in [begin, end) and passes them to handler.
+         * @details Stops at the footer or the first error, which only marks
+         *          the chunk failed. Only events between the first and the
+         *          last ';' of the chunk are parsed.
+         *
+         * @param begin Offset of the first line.
+         * @param end Offset after the last line.
+         * @param handler Handler of every parsed event.
+         * @param chunk What was found in the chunk.
+         */
+        void ParseChunk( size_t begin, size_t end, const EventHandler &handler, MetaDataChunk &chunk ) const;
+
+        /**
+         * @brief Returns size of the mapped file.
+         */
+        size_t Size( ) const { return size; }
+
+        /**
+         * @brief Returns 64-bit hash of the mapped file, to tell whether a cache of it is stale.
+         */
+        uint64_t Hash( ) const;
+
+        /**
+         * @brief Parses one event the way "C(descriptor)cycles" is matched by the meta-data grammar.
+         * @details White space is allowed around every part, the descriptor
+         *          keeps white space before ')'. Cycles too large for long int
+         *          are LONG_MAX, as strtol returns them.
+         *
+         * @return False if event does not match the grammar.
+         */
+        static bool ParseEvent( std::string_view event, char &code, std::string_view &descriptor, long int &cycles );
+};
+
+#endif // _META_DATA_PARSER
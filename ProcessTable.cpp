@@ -0,0 +1,92 @@
+#include "ProcessTable.h"
+#include "SimError.h"
+
+const unsigned int ProcessChunk::SHIFT;
+const unsigned int ProcessChunk::SIZE;
+const unsigned int ProcessTable::MAX_CHUNKS;
+
+ProcessTable::ProcessTable():
+    used(0),
+    chunkCount(0),
+    reused(0)
+{
+    for( unsigned int i = 0; i < MAX_CHUNKS; ++i )
+        chunks[i] = NULL;
+    pthread_mutex_init( &tableMutex, NULL );
+}
+
+ProcessTable::~ProcessTable()
+{
+    for( size_t i = 0; i < chunkCount; ++i )
+        delete chunks[i].load();
+    pthread_mutex_destroy( &tableMutex );
+}
+
+PCB *ProcessTable::Allocate( )
+{
+    pthread_mutex_lock( &tableMutex );
+    unsigned int pid;
+    if( !freePids.empty() )
+    {
+        pid = freePids.front();
+        freePids.pop_front();
+        ++reused;
+    }
+    else
+    {
+        pid = used;
+        size_t chunk = pid >> ProcessChunk::SHIFT;
+        if( chunk == chunkCount )
+        {
+            if( chunk == MAX_CHUNKS )
+            {
+                pthread_mutex_unlock( &tableMutex );
+                throw SimError( "Process table is full, %u processes are running.", used );
+            }
+            // Readers index chunks without the lock, publish it constructed
+            chunks[chunk].store( new ProcessChunk(), std::memory_order_release );
+            ++chunkCount;
+        }
+        ++used;
+    }
+    pthread_mutex_unlock( &tableMutex );
+
+    PCB *process = Get( pid );
+    process->pid = pid;
+    return process;
+}
+
+void ProcessTable::Release( PCB *process )
+{
+    pthread_mutex_lock( &tableMutex );
+    freePids.push_back( process->pid );
+    pthread_mutex_unlock( &tableMutex );
+}
+
+PCB *ProcessTable::Get( unsigned int pid ) const
+{
+    ProcessChunk *chunk = chunks[pid >> ProcessChunk::SHIFT].load( std::memory_order_acquire );
+    return &chunk->pcbs[pid & (ProcessChunk::SIZE - 1)];
+}
+
+unsigned int ProcessTable::Peak( ) const
+{
+    return used;
+}
+
+size_t ProcessTable::Chunks( ) const
+{
+    return chunkCount;
+}
+
+unsigned long ProcessTable::Reused( ) const
+{
+    return reused;
+}
+
+void ProcessTable::Clear( )
+{
+    freePids.clear();
+    used = 0;
+    reused = 0;
+}
@@ -0,0 +1,150 @@
+#ifndef _PROCESS_TABLE
+#define _PROCESS_TABLE
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+#include <pthread.h>
+
+#include "Scheduler.h"
+
+struct Program;
+
+/**
+ * @brief Process state enumeration used in PCB structure.
+ *
+ */
+enum class ProcessState : unsigned char {
+    START, READY, RUNNING, WAITING, EXIT
+};
+
+/**
+ * @brief Progress of page-in of a faulted page.
+ *
+ */
+enum class PageInState : unsigned char {
+    NONE,       // No page-in outstanding
+    PENDING,    // Page faulted, hard drive wasn't available yet
+    WAITING     // Waiting for hard drive to load the page
+};
+
+/**
+ * @brief Holds information about process in simulation.
+ *
+ */
+struct PCB{
+    unsigned int pid;
+    const Program *program;
+    size_t pc;
+    bool eventInProgress;
+    unsigned long eventTimeRemaining;
+    unsigned long memAccesses;      // Pages touched by current memory event
+    PageInState pageIn;
+    unsigned long faultTime;
+    unsigned int lastCore;
+    unsigned long cpuTime;
+    SchedEntity sched;
+    std::atomic<bool> parked;
+    PCB *intakeNext;                    // Link in ReadyQueue intake
+    bool intakeWoken;                   // Woken flag pushed with it, read at dispatch
+    std::atomic<uint64_t> wakeTime;     // TscClock ns, published by state CAS
+    std::atomic<ProcessState> state;
+    unsigned long remainingTime;
+    unsigned int priority;              // MLFQ queue
+
+    std::atomic<ProcessState> &State( );
+    unsigned long &RemainingTime( );
+    unsigned int &Priority( );
+};
+
+/**
+ * @brief Slab of PCBs.
+ *
+ */
+struct ProcessChunk{
+    static const unsigned int SHIFT = 10;
+    static const unsigned int SIZE = 1u << SHIFT;
+
+    PCB pcbs[SIZE];
+};
+
+inline std::atomic<ProcessState> &PCB::State( )
+{
+    return state;
+}
+
+inline unsigned long &PCB::RemainingTime( )
+{
+    return remainingTime;
+}
+
+inline unsigned int &PCB::Priority( )
+{
+    return priority;
+}
+
+/**
+ * @brief PCBs of the simulation indexed by PID.
+ * @details PCBs are allocated in chunks which are never moved or freed
+ *          while the table lives, so Get is lock-free and a PCB pointer
+ *          stays valid while other threads allocate. PIDs of exited
+ *          processes are reused in the order they were released.
+ *
+ */
+class ProcessTable
+{
+    private:
+        static const unsigned int MAX_CHUNKS = 4096;
+
+        std::atomic<ProcessChunk *> chunks[MAX_CHUNKS];
+        std::deque<unsigned int> freePids;
+        unsigned int used;
+        size_t chunkCount;
+        unsigned long reused;
+        pthread_mutex_t tableMutex;
+
+    public:
+        ProcessTable();
+        ~ProcessTable();
+
+        /**
+         * @brief Takes a PID and its PCB, safe to call from any thread.
+         * @details Only pid, chunk and slot of returned PCB are set.
+         *
+         * @return PCB, throws SimError once table is full.
+         */
+        PCB *Allocate( );
+
+        /**
+         * @brief Returns PID of exited process to the table for reuse.
+         */
+        void Release( PCB *process );
+
+        /**
+         * @brief Returns PCB of PID, lock-free.
+         */
+        PCB *Get( unsigned int pid ) const;
+
+        /**
+         * @brief Returns number of PIDs ever handed out.
+         */
+        unsigned int Peak( ) const;
+
+        /**
+         * @brief Returns number of chunks allocated.
+         */
+        size_t Chunks( ) const;
+
+        /**
+         * @brief Returns number of allocations that reused a released PID.
+         */
+        unsigned long Reused( ) const;
+
+        /**
+         * @brief Releases all PIDs, chunks are kept. Not thread-safe.
+         */
+        void Clear( );
+};
+
+#endif // _PROCESS_TABLE
@@ -0,0 +1,54 @@
+#ifndef _PROGRAM
+#define _PROGRAM
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Meta-data event descriptors, interned when meta-data is parsed.
+ * 
+ */
+enum class EventDescriptor : unsigned char {
+    START, END, RUN, HARD_DRIVE, KEYBOARD, MOUSE, MONITOR, SPEAKER, PRINTER, BLOCK, ALLOCATE,
+    COUNT
+};
+
+/**
+ * @brief A parsed structure of metadata unit.
+ * 
+ */
+struct SimEvent
+{
+    char code;
+    EventDescriptor descriptor;
+    unsigned int cycles;
+};
+static_assert( sizeof(SimEvent) == 8, "SimEvent is expected to pack into 8 bytes" );
+
+/**
+ * @brief Returns meta-data name of event descriptor.
+ * 
+ * @param descriptor Event descriptor.
+ * @return Descriptor as written in meta-data, e.g. "hard drive".
+ */
+const char * DescriptorName( EventDescriptor descriptor );
+/**
+ * @brief A parsed application, its program image.
+ * @details Immutable once meta-data is read, every process running the
+ *          application shares it and keeps its own program counter.
+ *          Events are read through eventData, which points into events of
+ *          a parsed program and into the mapped cache of a cached one.
+ *          Streamed program is freed by the last of the loader and its
+ *          processes to release it.
+ * 
+ */
+struct Program
+{
+    std::vector<SimEvent> events;   // Events of parsed program, empty for cached one
+    const SimEvent *eventData;
+    size_t eventCount;
+    unsigned long workTime; // ms of P and M events
+    mutable unsigned int refs = 0;  // Holders of streamed program, guarded by simMutex
+};
+
+#endif // _PROGRAM
@@ -0,0 +1,83 @@
+#include "ProgramQueue.h"
+#include "Program.h"
+
+ProgramQueue::ProgramQueue( ) : head( 0 ), count( 0 ), closed( false ), cancelled( false )
+{
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &notEmpty, NULL );
+    pthread_cond_init( &notFull, NULL );
+}
+
+ProgramQueue::~ProgramQueue( )
+{
+    Cancel();
+    pthread_cond_destroy( &notFull );
+    pthread_cond_destroy( &notEmpty );
+    pthread_mutex_destroy( &mutex );
+}
+
+void ProgramQueue::Reset( size_t depth )
+{
+    pthread_mutex_lock( &mutex );
+    for( ; count > 0; --count, head = (head + 1) % ring.size() )
+        delete ring[head];
+    ring.assign( depth, NULL );
+    head = 0;
+    closed = false;
+    cancelled = false;
+    pthread_mutex_unlock( &mutex );
+}
+
+bool ProgramQueue::Push( Program *program )
+{
+    pthread_mutex_lock( &mutex );
+    while( count == ring.size() && !cancelled )
+        pthread_cond_wait( &notFull, &mutex );
+    if( cancelled )
+    {
+        pthread_mutex_unlock( &mutex );
+        return false;
+    }
+    ring[(head + count) % ring.size()] = program;
+    ++count;
+    pthread_cond_signal( &notEmpty );
+    pthread_mutex_unlock( &mutex );
+    return true;
+}
+
+bool ProgramQueue::Pop( Program *&program )
+{
+    pthread_mutex_lock( &mutex );
+    while( count == 0 && !closed && !cancelled )
+        pthread_cond_wait( &notEmpty, &mutex );
+    if( count == 0 || cancelled )
+    {
+        pthread_mutex_unlock( &mutex );
+        return false;
+    }
+    program = ring[head];
+    head = (head + 1) % ring.size();
+    --count;
+    pthread_cond_signal( &notFull );
+    pthread_mutex_unlock( &mutex );
+    return true;
+}
+
+void ProgramQueue::Close( )
+{
+    pthread_mutex_lock( &mutex );
+    closed = true;
+    pthread_cond_broadcast( &notEmpty );
+    pthread_mutex_unlock( &mutex );
+}
+
+void ProgramQueue::Cancel( )
+{
+    pthread_mutex_lock( &mutex );
+    for( ; count > 0; --count, head = (head + 1) % ring.size() )
+        delete ring[head];
+    cancelled = true;
+    pthread_cond_broadcast( &notEmpty );
+    pthread_cond_broadcast( &notFull );
+    pthread_mutex_unlock( &mutex );
+}
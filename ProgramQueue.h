@@ -0,0 +1,64 @@
+#ifndef _PROGRAM_QUEUE
+#define _PROGRAM_QUEUE
+
+#include <cstddef>
+#include <vector>
+
+#include <pthread.h>
+
+struct Program;
+
+/**
+ * @brief Bounded queue of programs from meta-data reader thread to loader.
+ * @details Reader blocks while the queue is full, loader while it is
+ *          empty, so the reader never gets more than the queue depth of
+ *          programs ahead of the loader. Reader closes the queue when
+ *          meta-data ends, loader then takes what is left and stops.
+ *
+ */
+class ProgramQueue
+{
+    private:
+        std::vector<Program *> ring;
+        size_t head;
+        size_t count;
+        bool closed;
+        bool cancelled;
+
+        pthread_mutex_t mutex;
+        pthread_cond_t notEmpty;
+        pthread_cond_t notFull;
+
+    public:
+        ProgramQueue( );
+        ~ProgramQueue( );
+
+        /**
+         * @brief Empties the queue and reopens it with room for depth programs.
+         */
+        void Reset( size_t depth );
+
+        /**
+         * @brief Adds program, waits while the queue is full.
+         * @return False if the queue was cancelled, program is not added.
+         */
+        bool Push( Program *program );
+
+        /**
+         * @brief Takes next program, waits while the queue is empty and open.
+         * @return False once the queue is closed and empty, or cancelled.
+         */
+        bool Pop( Program *&program );
+
+        /**
+         * @brief Marks the end of programs, called by the reader.
+         */
+        void Close( );
+
+        /**
+         * @brief Stops both sides, programs still queued are deleted.
+         */
+        void Cancel( );
+};
+
+#endif // _PROGRAM_QUEUE
@@ -0,0 +1,187 @@
+#include "ReadyQueue.h"
+#include "ProcessTable.h"
+
+#include "TscClock.h"
+
+ReadyQueue::ReadyQueue():
+    intake(NULL),
+    scheduler(NULL),
+    sleeping(false),
+    notified(false)
+{
+    pthread_mutex_init(&heapMutex, NULL);
+    pthread_mutex_init(&sleepMutex, NULL);
+    pthread_cond_init(&sleepCond, NULL);
+    Clear();
+}
+
+ReadyQueue::~ReadyQueue()
+{
+    Clear();
+    delete scheduler;
+    pthread_cond_destroy(&sleepCond);
+    pthread_mutex_destroy(&sleepMutex);
+    pthread_mutex_destroy(&heapMutex);
+}
+
+void ReadyQueue::SetScheduler( Scheduler *policy )
+{
+    delete scheduler;
+    scheduler = policy;
+}
+
+void ReadyQueue::Push( PCB *process, bool woken )
+{
+    uint64_t t_start = TscClock::NowNs();
+
+    process->intakeWoken = woken;
+    process->intakeNext = intake.load();
+    unsigned long retries = 0;
+    while(!intake.compare_exchange_weak(process->intakeNext, process))
+        ++retries;
+
+    // Dispatcher sets sleeping before it checks intake, so one of us sees the other
+    if(sleeping)
+    {
+        pthread_mutex_lock(&sleepMutex);
+        pthread_cond_signal(&sleepCond);
+        pthread_mutex_unlock(&sleepMutex);
+        ++wakeups;
+    }
+
+    unsigned long long stall = TscClock::NowNs() - t_start;
+    ++pushes;
+    casRetries += retries;
+    stallNs += stall;
+    unsigned long long max = maxStallNs;
+    while(stall > max && !maxStallNs.compare_exchange_weak(max, stall));
+}
+
+void ReadyQueue::drain( )
+{
+    PCB *process = intake.exchange(NULL);
+
+    // Intake is a stack, reverse it so policy sees processes in push order
+    PCB *reversed = NULL;
+    while(process)
+    {
+        PCB *next = process->intakeNext;
+        process->intakeNext = reversed;
+        reversed = process;
+        process = next;
+    }
+    while(reversed)
+    {
+        PCB *next = reversed->intakeNext;
+        if(scheduler)
+        {
+            if(reversed->intakeWoken)
+                scheduler->OnWake(reversed);
+            scheduler->Enqueue(reversed);
+        }
+        reversed = next;
+    }
+}
+
+bool ReadyQueue::Pop( PCB *&process )
+{
+    pthread_mutex_lock(&heapMutex);
+    drain();
+    process = scheduler->PickNext();
+    pthread_mutex_unlock(&heapMutex);
+    return process != NULL;
+}
+
+bool ReadyQueue::Tick( PCB *running, unsigned long ranMs )
+{
+    pthread_mutex_lock(&heapMutex);
+    drain();
+    bool preempt = scheduler->OnTick(running, ranMs);
+    pthread_mutex_unlock(&heapMutex);
+    return preempt;
+}
+
+void ReadyQueue::Block( PCB *process )
+{
+    pthread_mutex_lock(&heapMutex);
+    scheduler->OnBlock(process);
+    pthread_mutex_unlock(&heapMutex);
+}
+
+unsigned long ReadyQueue::Quantum( PCB *process )
+{
+    pthread_mutex_lock(&heapMutex);
+    unsigned long quantum = scheduler->Quantum(process);
+    pthread_mutex_unlock(&heapMutex);
+    return quantum;
+}
+
+void ReadyQueue::Boost( unsigned long epoch )
+{
+    pthread_mutex_lock(&heapMutex);
+    drain();
+    scheduler->OnBoost(epoch);
+    pthread_mutex_unlock(&heapMutex);
+}
+
+bool ReadyQueue::Empty( )
+{
+    pthread_mutex_lock(&heapMutex);
+    drain();
+    bool empty = scheduler->Size() == 0;
+    pthread_mutex_unlock(&heapMutex);
+    return empty;
+}
+
+size_t ReadyQueue::Size( )
+{
+    pthread_mutex_lock(&heapMutex);
+    drain();
+    size_t size = scheduler->Size();
+    pthread_mutex_unlock(&heapMutex);
+    return size;
+}
+
+void ReadyQueue::Wait( )
+{
+    pthread_mutex_lock(&sleepMutex);
+    sleeping = true;
+    while(!intake.load() && !notified)
+        pthread_cond_wait(&sleepCond, &sleepMutex);
+    sleeping = false;
+    notified = false;
+    pthread_mutex_unlock(&sleepMutex);
+}
+
+void ReadyQueue::Notify( )
+{
+    pthread_mutex_lock(&sleepMutex);
+    notified = true;
+    pthread_cond_signal(&sleepCond);
+    pthread_mutex_unlock(&sleepMutex);
+}
+
+ReadyQueueStats ReadyQueue::Stats( ) const
+{
+    return ReadyQueueStats{ pushes, casRetries, stallNs, maxStallNs, wakeups };
+}
+
+const Scheduler &ReadyQueue::Policy( ) const
+{
+    return *scheduler;
+}
+
+void ReadyQueue::Clear( )
+{
+    pthread_mutex_lock(&heapMutex);
+    drain();
+    if(scheduler)
+        scheduler->Clear();
+    pthread_mutex_unlock(&heapMutex);
+    notified = false;
+    pushes = 0;
+    casRetries = 0;
+    stallNs = 0;
+    maxStallNs = 0;
+    wakeups = 0;
+}
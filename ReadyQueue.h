@@ -0,0 +1,148 @@
+#ifndef _READY_QUEUE
+#define _READY_QUEUE
+
+#include <atomic>
+
+#include <pthread.h>
+
+#include "Scheduler.h"
+
+/**
+ * @brief Contention counters of ReadyQueue producers.
+ *
+ */
+struct ReadyQueueStats
+{
+    unsigned long pushes;
+    unsigned long casRetries;
+    unsigned long long stallNs;
+    unsigned long long maxStallNs;
+    unsigned long wakeups;
+};
+
+/**
+ * @brief Scheduling queue shared by producers and the dispatcher.
+ * @details Producers (loader, IO completions) push into a lock-free intake
+ *          stack and never wait on the dispatcher. The stack is linked
+ *          through the PCBs, so pushes don't allocate. Intake is handed to
+ *          the scheduling policy whenever a process is popped. The policy is
+ *          guarded by a mutex only contended when an idle CPU steals from
+ *          this queue, so any thread may pop, but only the owning dispatcher
+ *          may Wait.
+ *
+ */
+class ReadyQueue
+{
+    private:
+        std::atomic<PCB *> intake;      // Linked through PCB intakeNext
+        Scheduler *scheduler;
+        pthread_mutex_t heapMutex;
+
+        std::atomic<bool> sleeping;
+        bool notified;
+        pthread_mutex_t sleepMutex;
+        pthread_cond_t sleepCond;
+
+        std::atomic<unsigned long> pushes;
+        std::atomic<unsigned long> casRetries;
+        std::atomic<unsigned long long> stallNs;
+        std::atomic<unsigned long long> maxStallNs;
+        std::atomic<unsigned long> wakeups;
+
+        /**
+         * @brief Enqueues every process from intake into policy, in push order.
+         * @details Caller must hold heapMutex.
+         */
+        void drain( );
+
+    public:
+        ReadyQueue();
+        ~ReadyQueue();
+
+        /**
+         * @brief Sets scheduling policy, queue takes ownership of it.
+         * @details Must be called before queue is used.
+         */
+        void SetScheduler( Scheduler *policy );
+
+        /**
+         * @brief Adds runnable process to the queue, safe to call from any thread.
+         * @details Process must not be in any ready queue already.
+         *
+         * @param process Process to add.
+         * @param woken True if process just finished IO.
+         */
+        void Push( PCB *process, bool woken );
+
+        /**
+         * @brief Removes process scheduling policy picks to run next.
+         *
+         * @param process Set to popped process.
+         * @return False if queue is empty.
+         */
+        bool Pop( PCB *&process );
+
+        /**
+         * @brief Passes timer tick of running process to scheduling policy.
+         *
+         * @param running Process running on the core.
+         * @param ranMs Time in ms process ran since it was dispatched.
+         * @return True if process should be preempted.
+         */
+        bool Tick( PCB *running, unsigned long ranMs );
+
+        /**
+         * @brief Tells scheduling policy process left the core to wait on IO.
+         */
+        void Block( PCB *process );
+
+        /**
+         * @brief Returns time process may run for before it is ticked.
+         * @return Time in ms, 0 if process has no quantum of its own.
+         */
+        unsigned long Quantum( PCB *process );
+
+        /**
+         * @brief Passes periodic priority boost to scheduling policy.
+         *
+         * @param epoch Number of boosts so far.
+         */
+        void Boost( unsigned long epoch );
+
+        /**
+         * @brief Checks whether queue is empty.
+         */
+        bool Empty( );
+
+        /**
+         * @brief Returns number of queued processes.
+         */
+        size_t Size( );
+
+        /**
+         * @brief Blocks owning dispatcher until a process is pushed or Notify is called.
+         */
+        void Wait( );
+
+        /**
+         * @brief Wakes up dispatcher blocked in Wait, even if queue is empty.
+         */
+        void Notify( );
+
+        /**
+         * @brief Returns producer contention counters.
+         */
+        ReadyQueueStats Stats( ) const;
+
+        /**
+         * @brief Returns scheduling policy of this queue.
+         */
+        const Scheduler &Policy( ) const;
+
+        /**
+         * @brief Drops all processes and resets counters. Not thread-safe.
+         */
+        void Clear( );
+};
+
+#endif // _READY_QUEUE
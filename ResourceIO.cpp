@@ -1,48 +1,119 @@
 #include "ResourceIO.h"
 #include "Simulation.h"
 
-#include <chrono>
 #include <stdexcept>
 #include <string>
 #include <cstring>
 
-void *ResourceIO::doWork( void *p )
+ResourceIO::ResourceIO()
 {
-    ResIOThreadParams *params = (ResIOThreadParams *)p;
+    pthread_mutex_init(&queueMutex, NULL);
+}
 
-    Simulation *sim = params->sim;
-    unsigned long time = params->time;
-    unsigned int pid = params->pid;
-    char *device_str = params->deviceStr;
+ResourceIO::~ResourceIO()
+{
+    Shutdown();
 
-    auto t_end = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds( time );
-    while(std::chrono::high_resolution_clock::now() < t_end);
+    while(freeRequests)
+    {
+        ResIORequest *request = freeRequests;
+        freeRequests = request->next;
+        delete request;
+    }
+    pthread_mutex_destroy(&queueMutex);
+}
 
-    if(sim->processes[pid]->state == ProcessState::WAITING)
-        sim->processes[pid]->state = ProcessState::READY;
+void ResourceIO::Start( )
+{
+    if( devices )
+        return;
 
-    sim->Log( "%lf - Process %d: end %s\n", sim->simTime(), pid, device_str );
+    devices = new ResIODevice[queueCount];
+    for( unsigned int i = 0; i < queueCount; ++i )
+    {
+        devices[i].resource = this;
+        devices[i].head = NULL;
+        devices[i].tail = NULL;
+    }
+}
+
+void ResourceIO::Shutdown( )
+{
+    delete [] devices;
+    devices = NULL;
+}
 
-    delete params;
-    return NULL;
+ResIORequest *ResourceIO::acquireRequest( )
+{
+    ResIORequest *request = freeRequests;
+    if( request )
+        freeRequests = request->next;
+    else
+        request = new ResIORequest();
+    request->next = NULL;
+    return request;
 }
 
-void ResourceIO::run( unsigned int cycles, unsigned int pid, const char * device_str )
+void ResourceIO::finish( ResIODevice *device )
 {
-    ResIOThreadParams *params = new ResIOThreadParams();
+    ResourceIO *resource = device->resource;
+
+    // Request stays at head while it completes, so run queues behind it
+    pthread_mutex_lock(&resource->queueMutex);
+    ResIORequest *request = device->head;
+    pthread_mutex_unlock(&resource->queueMutex);
 
-    params->sim = sim;
-    params->time = cycleTime * cycles;
-    params->pid = pid;
-    strncpy ( params->deviceStr, device_str, 32 );
+    complete( resource->sim, request->pid, request->kind, request->device );
 
-    sim->Log( "%lf - Process %d: start %s\n", sim->simTime(), pid, device_str );
+    pthread_mutex_lock(&resource->queueMutex);
+    device->head = request->next;
+    if(!device->head)
+        device->tail = NULL;
 
-    pthread_t ioThread;
-    int rc = pthread_create(&ioThread, NULL, doWork, params);
-    if( rc )
-        throw std::runtime_error( "Unable to create IO thread, error code (" + std::to_string(rc) +")." );
-    //pthread_join(ioThread, NULL);
+    // Recycle the request
+    request->next = resource->freeRequests;
+    resource->freeRequests = request;
+
+    ResIORequest *next = device->head;
+    unsigned long time = next ? next->time : 0;
+    pthread_mutex_unlock(&resource->queueMutex);
+
+    if( next )
+        resource->sim->ScheduleEvent( time, [device]{ finish( device ); } );
+}
+
+void ResourceIO::complete( Simulation *sim, unsigned int pid, TraceDevice kind, unsigned int device )
+{
+    SIM_LOG( sim, DEVICE, DETAIL, Trace( TraceEvent::IO_END, pid, TRACE_NO_CORE, kind, device ) );
+    sim->WakeProcess( pid );
+}
+
+void ResourceIO::run( unsigned int cycles, unsigned int pid, TraceDevice kind, unsigned int device )
+{
+    if( !devices )
+        throw std::runtime_error( "IO resource used before it was started." );
+    ResIODevice *dev = &devices[device % queueCount];
+
+    SIM_LOG( sim, DEVICE, DETAIL, Trace( TraceEvent::IO_START, pid, sim->TraceCore(), kind, device ) );
+
+    pthread_mutex_lock(&queueMutex);
+    ResIORequest *request = acquireRequest();
+    request->time = cycleTime * cycles;
+    request->pid = pid;
+    request->kind = kind;
+    request->device = device;
+
+    if( dev->tail )
+        dev->tail->next = request;
+    else
+        dev->head = request;
+    dev->tail = request;
+    bool idle = dev->head == request;
+    pthread_mutex_unlock(&queueMutex);
+
+    // Device was idle, request is served right away
+    if( idle )
+        sim->ScheduleEvent( request->time, [dev]{ finish( dev ); } );
 }
 
 
@@ -52,6 +123,7 @@ IOResourceSemaphore::IOResourceSemaphore( unsigned int count ):
 	deviceCount(count),
 	deviceIndex(0)
 {
+	queueCount = count;
 	sem_init(&s, 0, count);
     pthread_mutex_init(&update_mutex, NULL);	
 }
@@ -94,9 +166,7 @@ bool ResourceHDD::run( unsigned int cycles, ResIOState ioState, unsigned int pid
         deviceIndex = (deviceIndex+1)%deviceCount;
         pthread_mutex_unlock(&update_mutex);
 
-        char device_str[32];
-        sprintf (device_str, "hard drive %s on HDD %d", ioState == INPUT ? "input" : "output", dev_id);
-        ResourceIO::run( cycles, pid, device_str );
+        ResourceIO::run( cycles, pid, ioState == INPUT ? TraceDevice::HDD_INPUT : TraceDevice::HDD_OUTPUT, dev_id );
 
         sem_post(&s);
         return true;
@@ -121,9 +191,7 @@ bool ResourcePrinter::run( unsigned int cycles, ResIOState ioState, unsigned int
         deviceIndex = (deviceIndex+1)%deviceCount;
         pthread_mutex_unlock(&update_mutex);
 
-        char device_str[32];
-        sprintf (device_str, "printer output on PRNTR %d", dev_id);
-        ResourceIO::run( cycles, pid, device_str );
+        ResourceIO::run( cycles, pid, TraceDevice::PRINTER, dev_id );
 
         sem_post(&s);
         return true;
@@ -147,9 +215,7 @@ bool ResourceSpeaker::run( unsigned int cycles, ResIOState ioState, unsigned int
         deviceIndex = (deviceIndex+1)%deviceCount;
         pthread_mutex_unlock(&update_mutex);
 
-        char device_str[32];
-        sprintf (device_str, "speaker output on SPKR %d", dev_id);
-        ResourceIO::run( cycles, pid, device_str );
+        ResourceIO::run( cycles, pid, TraceDevice::SPEAKER, dev_id );
 
         sem_post(&s);
         return true;
@@ -169,7 +235,7 @@ bool ResourceMonitor::run( unsigned int cycles, ResIOState ioState, unsigned int
     if(pthread_mutex_trylock(&m) == 0)
     {
         // Mutex retrieved
-        ResourceIO::run( cycles, pid, "monitor output" );
+        ResourceIO::run( cycles, pid, TraceDevice::MONITOR );
         pthread_mutex_unlock(&m);
         return true;
     }
@@ -187,7 +253,7 @@ bool ResourceKeyboard::run( unsigned int cycles, ResIOState ioState, unsigned in
     if(pthread_mutex_trylock(&m) == 0)
     {
         // Mutex retrieved
-        ResourceIO::run( cycles, pid, "keyboard input" );
+        ResourceIO::run( cycles, pid, TraceDevice::KEYBOARD );
         pthread_mutex_unlock(&m);
         return true;
     }
@@ -206,7 +272,7 @@ bool ResourceMouse::run( unsigned int cycles, ResIOState ioState, unsigned int p
     if(pthread_mutex_trylock(&m) == 0)
     {
         // Mutex retrieved
-        ResourceIO::run( cycles, pid, "mouse input" );
+        ResourceIO::run( cycles, pid, TraceDevice::MOUSE );
         pthread_mutex_unlock(&m);
         return true;
     }
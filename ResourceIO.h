@@ -4,20 +4,46 @@
 #include <pthread.h>
 #include <semaphore.h>
 
+#include "Trace.h"
+
 class Simulation;
+class ResourceIO;
 
 enum ResIOState { INPUT, OUTPUT };
-struct ResIOThreadParams
+
+/**
+ * @brief IO request queued on a device, recycled through resource free list.
+ * 
+ */
+struct ResIORequest
 {
-	Simulation *sim;
 	unsigned long time;
 	unsigned int pid;
-	char deviceStr[32];
+	TraceDevice kind;
+	unsigned int device;
+	ResIORequest *next;
+};
+
+/**
+ * @brief Single device of a resource, serves its queued requests in order.
+ * @details Head of the queue is the request in service, device is idle when
+ * 			queue is empty.
+ * 
+ */
+struct ResIODevice
+{
+	ResourceIO *resource;
+	ResIORequest *head;
+	ResIORequest *tail;
 };
 
 
 /**
  * @brief Generic resource class shared by all resources.
+ * @details Each device of the resource serves requests queued on it in order.
+ * 			Device time is a timer on simulation timer service, the request
+ * 			completes from its callback which then starts the next one, so no
+ * 			thread waits on a device.
  * 
  */
 class ResourceIO
@@ -25,22 +51,58 @@ class ResourceIO
 	protected:
 		Simulation *sim;
 		unsigned int cycleTime;
+		unsigned int queueCount = 1;
+
         /**
-         * @brief pthread function to do simulation work.
+         * @brief Timer callback of device, completes request in service.
+         * @details Starts next request queued on the device, if any.
          * 
-         * @param arg pointer to long int variable.
-         * @return always returns NULL.
+         * @param device Device whose request finished.
          */
-        static void *doWork( void *ms );
+        static void finish( ResIODevice *device );
+
+        /**
+         * @brief Finishes IO request, wakes up waiting process and logs it.
+         * 
+         * @param sim Pointer to Simulation instance.
+         * @param pid The process which inquired IO resource.
+         * @param kind Device named in log.
+         * @param device Index of device.
+         */
+        static void complete( Simulation *sim, unsigned int pid, TraceDevice kind, unsigned int device );
 
         /**
          * @brief Runs resource for given cycles
          * 
          * @param int Number of cycles to run.
+         * @param pid The process which inquiries IO resource.
+         * @param kind Device named in log.
+         * @param device Index of device to queue request on.
          */
-    	void run( unsigned int cycles, unsigned int pid, const char * device_str );
+    	void run( unsigned int cycles, unsigned int pid, TraceDevice kind, unsigned int device = 0 );
 	private:
+		pthread_mutex_t queueMutex;
+		ResIODevice *devices = NULL;
+		ResIORequest *freeRequests = NULL;
+
+		/**
+		 * @brief Takes request from free list, allocates new one if list is empty.
+		 * @details Caller must hold queueMutex.
+		 */
+		ResIORequest *acquireRequest( );
     public:
+		ResourceIO();
+		virtual ~ResourceIO();
+
+		/**
+		 * @brief Creates device queues.
+		 */
+		void Start( );
+
+		/**
+		 * @brief Frees device queues, every request must have completed.
+		 */
+		void Shutdown( );
     	
     	/**
     	 * @brief Public pure virtual function, used by Simulation to run cycles on resource.
@@ -0,0 +1,514 @@
+#include "Scheduler.h"
+#include "ProcessTable.h"
+#include "SimConfig.h"
+#include "TimerService.h"
+
+#include "TscClock.h"
+#include <cstring>
+#include <algorithm>
+
+void QueueStats::Merge( const QueueStats &other )
+{
+    dispatches += other.dispatches;
+    residenceTotal += other.residenceTotal;
+    residenceMax = std::max( residenceMax, other.residenceMax );
+    responses += other.responses;
+    responseTotal += other.responseTotal;
+    responseMax = std::max( responseMax, other.responseMax );
+}
+
+void SchedulerStats::Merge( const SchedulerStats &other )
+{
+    decisions += other.decisions;
+    totalNs += other.totalNs;
+    maxNs = std::max( maxNs, other.maxNs );
+    for( size_t i = 0; i < 64; ++i )
+        histogram[i] += other.histogram[i];
+}
+
+unsigned long long SchedulerStats::Percentile( double percentile ) const
+{
+    unsigned long rank = (unsigned long)(decisions * percentile / 100.0);
+    unsigned long seen = 0;
+    for( size_t i = 0; i < 64; ++i )
+    {
+        seen += histogram[i];
+        if( seen > rank )
+            return std::min( 2ULL << i, maxNs );
+    }
+    return maxNs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Scheduler::Scheduler():
+    clock(NULL)
+{
+    memset( &stats, 0, sizeof stats );
+}
+
+Scheduler::~Scheduler()
+{
+
+}
+
+Scheduler *Scheduler::Create( SchedulingCode code, const SimConfig &settings, const TimerService &clock )
+{
+    unsigned long quantum = settings.quantumMs;
+
+    Scheduler *policy = NULL;
+    switch( code )
+    {
+        case SchedulingCode::RR:   policy = new RoundRobinScheduler( quantum ); break;
+        case SchedulingCode::SRTF: policy = new SrtfScheduler(); break;
+        case SchedulingCode::CFS:  policy = new CfsScheduler( quantum ); break;
+        case SchedulingCode::MLFQ:
+            policy = new MlfqScheduler( settings.mlfqQueueCount, quantum, settings.mlfqBoostMs );
+            break;
+    }
+    policy->clock = &clock;
+    policy->queues.assign( policy->QueueCount(), QueueStats() );
+    return policy;
+}
+
+void Scheduler::record( unsigned long long ns )
+{
+    ++stats.decisions;
+    stats.totalNs += ns;
+    stats.maxNs = std::max( stats.maxNs, ns );
+
+    size_t bucket = 0;
+    while( ns >>= 1 )
+        ++bucket;
+    ++stats.histogram[bucket];
+}
+
+unsigned long Scheduler::TickPeriod( ) const
+{
+    return 0;
+}
+
+unsigned long Scheduler::Quantum( PCB *process )
+{
+    return 0;
+}
+
+unsigned long Scheduler::BoostPeriod( ) const
+{
+    return 0;
+}
+
+void Scheduler::OnBoost( unsigned long epoch )
+{
+
+}
+
+void Scheduler::Enqueue( PCB *process )
+{
+    unsigned long now = clock->Now();
+    if( process->State() == ProcessState::START )
+    {
+        process->sched.runnableAt = now;
+        process->sched.responsePending = true;
+    }
+    process->sched.queuedAt = now;
+
+    uint64_t t_start = TscClock::NowNs();
+    enqueue( process );
+    record( TscClock::NowNs() - t_start );
+}
+
+PCB *Scheduler::PickNext( )
+{
+    uint64_t t_start = TscClock::NowNs();
+    PCB *process = pickNext();
+    if( !process )
+        return NULL;
+    record( TscClock::NowNs() - t_start );
+
+    unsigned long now = clock->Now();
+    QueueStats &queue = queues[queueOf( process )];
+    unsigned long residence = now - process->sched.queuedAt;
+    ++queue.dispatches;
+    queue.residenceTotal += residence;
+    queue.residenceMax = std::max( queue.residenceMax, residence );
+    if( process->sched.responsePending )
+    {
+        unsigned long response = now - process->sched.runnableAt;
+        process->sched.responsePending = false;
+        ++queue.responses;
+        queue.responseTotal += response;
+        queue.responseMax = std::max( queue.responseMax, response );
+    }
+    return process;
+}
+
+bool Scheduler::OnTick( PCB *running, unsigned long ranMs )
+{
+    uint64_t t_start = TscClock::NowNs();
+    bool preempt = onTick( running, ranMs );
+    record( TscClock::NowNs() - t_start );
+    return preempt;
+}
+
+bool Scheduler::onTick( PCB *running, unsigned long ranMs )
+{
+    return false;
+}
+
+void Scheduler::OnBlock( PCB *process )
+{
+
+}
+
+void Scheduler::OnWake( PCB *process )
+{
+    process->sched.runnableAt = clock->Now();
+    process->sched.responsePending = true;
+    onWake( process );
+}
+
+void Scheduler::onWake( PCB *process )
+{
+
+}
+
+size_t Scheduler::queueOf( PCB *process ) const
+{
+    return 0;
+}
+
+void Scheduler::Clear( )
+{
+    clear();
+    memset( &stats, 0, sizeof stats );
+    queues.assign( queues.size(), QueueStats() );
+}
+
+const SchedulerStats &Scheduler::Stats( ) const
+{
+    return stats;
+}
+
+size_t Scheduler::QueueCount( ) const
+{
+    return 1;
+}
+
+unsigned long Scheduler::QueueQuantum( size_t queue ) const
+{
+    return TickPeriod();
+}
+
+const QueueStats &Scheduler::Queue( size_t queue ) const
+{
+    return queues[queue];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+RoundRobinScheduler::RoundRobinScheduler( unsigned long quantum ):
+    quantum(quantum)
+{
+
+}
+
+const char *RoundRobinScheduler::Name( ) const
+{
+    return "RR";
+}
+
+unsigned long RoundRobinScheduler::TickPeriod( ) const
+{
+    return quantum;
+}
+
+void RoundRobinScheduler::enqueue( PCB *process )
+{
+    queue.push_back( process );
+}
+
+PCB *RoundRobinScheduler::pickNext( )
+{
+    if( queue.empty() )
+        return NULL;
+    PCB *process = queue.front();
+    queue.pop_front();
+    return process;
+}
+
+bool RoundRobinScheduler::onTick( PCB *running, unsigned long ranMs )
+{
+    // Every tick is a quantum expiry
+    return true;
+}
+
+void RoundRobinScheduler::clear( )
+{
+    queue.clear();
+}
+
+size_t RoundRobinScheduler::Size( ) const
+{
+    return queue.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const char *SrtfScheduler::Name( ) const
+{
+    return "SRTF";
+}
+
+void SrtfScheduler::enqueue( PCB *process )
+{
+    heap.Push( Job{process, (long)process->RemainingTime()} );
+}
+
+PCB *SrtfScheduler::pickNext( )
+{
+    if( heap.Empty() )
+        return NULL;
+    PCB *process = heap.Top().process;
+    heap.Pop();
+    return process;
+}
+
+void SrtfScheduler::clear( )
+{
+    heap.Clear();
+}
+
+size_t SrtfScheduler::Size( ) const
+{
+    return heap.Size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+CfsScheduler::CfsScheduler( unsigned long period ):
+    minVruntime(0),
+    seqCounter(0),
+    period(period)
+{
+
+}
+
+const char *CfsScheduler::Name( ) const
+{
+    return "CFS";
+}
+
+unsigned long CfsScheduler::TickPeriod( ) const
+{
+    return period;
+}
+
+void CfsScheduler::update( PCB *process )
+{
+    process->sched.vruntime += process->cpuTime - process->sched.charged;
+    process->sched.charged = process->cpuTime;
+}
+
+void CfsScheduler::enqueue( PCB *process )
+{
+    if( process->State() == ProcessState::START )
+    {
+        // New process starts level with the others instead of owing them
+        process->sched.vruntime = minVruntime;
+        process->sched.charged = process->cpuTime;
+    }
+    else
+        update( process );
+
+    tree.insert( Entry{process->sched.vruntime, seqCounter++, process} );
+}
+
+PCB *CfsScheduler::pickNext( )
+{
+    if( tree.empty() )
+        return NULL;
+    auto leftmost = tree.begin();
+    PCB *process = leftmost->process;
+    minVruntime = std::max( minVruntime, leftmost->vruntime );
+    tree.erase( leftmost );
+    return process;
+}
+
+bool CfsScheduler::onTick( PCB *running, unsigned long ranMs )
+{
+    if( tree.empty() )
+        return false;
+    unsigned long vruntime = running->sched.vruntime + (running->cpuTime - running->sched.charged) + ranMs;
+    return vruntime > tree.begin()->vruntime;
+}
+
+void CfsScheduler::OnBlock( PCB *process )
+{
+    update( process );
+}
+
+void CfsScheduler::onWake( PCB *process )
+{
+    // Sleeping doesn't earn more than half a period of credit
+    update( process );
+    unsigned long credit = period / 2;
+    if( minVruntime > credit )
+        process->sched.vruntime = std::max( process->sched.vruntime, minVruntime - credit );
+}
+
+void CfsScheduler::clear( )
+{
+    tree.clear();
+    minVruntime = 0;
+    seqCounter = 0;
+}
+
+size_t CfsScheduler::Size( ) const
+{
+    return tree.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+MlfqScheduler::MlfqScheduler( size_t count, unsigned long quantum, unsigned long boostPeriod ):
+    queues(count),
+    count(count),
+    quantum(quantum),
+    boostPeriod(boostPeriod),
+    epoch(0)
+{
+
+}
+
+const char *MlfqScheduler::Name( ) const
+{
+    return "MLFQ";
+}
+
+void MlfqScheduler::update( PCB *process )
+{
+    process->sched.used += process->cpuTime - process->sched.charged;
+    process->sched.charged = process->cpuTime;
+}
+
+void MlfqScheduler::boost( PCB *process )
+{
+    if( process->sched.epoch == epoch )
+        return;
+    process->sched.epoch = epoch;
+    process->Priority() = 0;
+    process->sched.used = 0;
+}
+
+void MlfqScheduler::enqueue( PCB *process )
+{
+    if( process->State() == ProcessState::START )
+    {
+        process->Priority() = 0;
+        process->sched.used = 0;
+        process->sched.epoch = epoch;
+        process->sched.charged = process->cpuTime;
+    }
+    else
+    {
+        update( process );
+        if( process->sched.epoch != epoch )
+            boost( process );
+        else if( process->sched.used >= QueueQuantum( process->Priority() ) )
+        {
+            // Used up its quantum, demote
+            if( process->Priority() + 1 < count )
+                ++process->Priority();
+            process->sched.used = 0;
+        }
+    }
+    queues[process->Priority()].push_back( process );
+}
+
+PCB *MlfqScheduler::pickNext( )
+{
+    for( size_t level = 0; level < count; ++level )
+    {
+        if( !queues[level].empty() )
+        {
+            PCB *process = queues[level].front();
+            queues[level].pop_front();
+            return process;
+        }
+    }
+    return NULL;
+}
+
+unsigned long MlfqScheduler::Quantum( PCB *process )
+{
+    unsigned long levelQuantum = QueueQuantum( process->Priority() );
+    return process->sched.used < levelQuantum ? levelQuantum - process->sched.used : 1;
+}
+
+bool MlfqScheduler::onTick( PCB *running, unsigned long ranMs )
+{
+    unsigned long used = running->sched.used + (running->cpuTime - running->sched.charged) + ranMs;
+    return used >= QueueQuantum( running->Priority() );
+}
+
+unsigned long MlfqScheduler::BoostPeriod( ) const
+{
+    return boostPeriod;
+}
+
+void MlfqScheduler::OnBoost( unsigned long boostEpoch )
+{
+    epoch = boostEpoch;
+    for( size_t level = 1; level < count; ++level )
+    {
+        for( PCB *process : queues[level] )
+        {
+            boost( process );
+            queues[0].push_back( process );
+        }
+        queues[level].clear();
+    }
+    for( PCB *process : queues[0] )
+        boost( process );
+}
+
+void MlfqScheduler::OnBlock( PCB *process )
+{
+    // Gave up CPU before quantum ran out, promote
+    update( process );
+    boost( process );
+    if( process->Priority() > 0 )
+        --process->Priority();
+    process->sched.used = 0;
+}
+
+void MlfqScheduler::clear( )
+{
+    for( size_t level = 0; level < count; ++level )
+        queues[level].clear();
+    epoch = 0;
+}
+
+size_t MlfqScheduler::queueOf( PCB *process ) const
+{
+    return process->Priority();
+}
+
+size_t MlfqScheduler::Size( ) const
+{
+    size_t size = 0;
+    for( size_t level = 0; level < count; ++level )
+        size += queues[level].size();
+    return size;
+}
+
+size_t MlfqScheduler::QueueCount( ) const
+{
+    return count;
+}
+
+unsigned long MlfqScheduler::QueueQuantum( size_t queue ) const
+{
+    return quantum << queue;
+}
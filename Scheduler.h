@@ -0,0 +1,353 @@
+#ifndef _SCHEDULER
+#define _SCHEDULER
+
+#include "JobHeap.h"
+
+#include <deque>
+#include <set>
+#include <vector>
+
+struct SimConfig;
+class TimerService;
+
+/**
+ * @brief Scheduling enumeration.
+ *
+ */
+enum class SchedulingCode{
+    RR, SRTF, CFS, MLFQ
+};
+
+/**
+ * @brief Per-process state owned by scheduling policies.
+ *
+ */
+struct SchedEntity
+{
+    unsigned long vruntime;     // CFS virtual runtime in ms
+    unsigned long charged;      // Part of PCB cpuTime already accounted for
+    unsigned long used;         // MLFQ time used of the queue's quantum
+    unsigned long epoch;        // MLFQ boost the process has seen
+    unsigned long queuedAt;     // Time process was enqueued
+    unsigned long runnableAt;   // Time process arrived or woke up
+    bool responsePending;       // Process didn't run since runnableAt
+};
+
+/**
+ * @brief Residence and response time of one scheduling queue, in ms.
+ * @details Residence is time from enqueue to dispatch, response is time
+ *          from arrival or IO completion to dispatch.
+ *
+ */
+struct QueueStats
+{
+    unsigned long dispatches;
+    unsigned long long residenceTotal;
+    unsigned long residenceMax;
+    unsigned long responses;
+    unsigned long long responseTotal;
+    unsigned long responseMax;
+
+    /**
+     * @brief Adds counters of other stats to these.
+     */
+    void Merge( const QueueStats &other );
+};
+
+/**
+ * @brief Cost of scheduling decisions made by a policy.
+ *
+ */
+struct SchedulerStats
+{
+    unsigned long decisions;
+    unsigned long long totalNs;
+    unsigned long long maxNs;
+    unsigned long histogram[64]; // Decisions by highest set bit of their ns
+
+    /**
+     * @brief Adds counters of other stats to these.
+     */
+    void Merge( const SchedulerStats &other );
+
+    /**
+     * @brief Returns upper bound of given percentile of decision cost.
+     *
+     * @param percentile Percentile between 0 and 100.
+     * @return Cost in ns, rounded up to power of two.
+     */
+    unsigned long long Percentile( double percentile ) const;
+};
+
+/**
+ * @brief Scheduling policy of one CPU core.
+ * @details Policy keeps runnable processes of its core. Every call comes
+ *          from ReadyQueue with its heap mutex held, so policies don't need
+ *          any locking. Enqueue, PickNext and OnTick are decisions and
+ *          their cost is measured, as well as residence and response time
+ *          of every queue policy has.
+ *
+ */
+class Scheduler
+{
+    private:
+        SchedulerStats stats;
+        std::vector<QueueStats> queues;
+        const TimerService *clock;
+
+        void record( unsigned long long ns );
+
+    protected:
+        virtual void enqueue( PCB *process ) = 0;
+        virtual PCB *pickNext( ) = 0;
+        virtual bool onTick( PCB *running, unsigned long ranMs );
+        virtual void onWake( PCB *process );
+        virtual void clear( ) = 0;
+
+        /**
+         * @brief Returns queue process is in, or would be enqueued into.
+         */
+        virtual size_t queueOf( PCB *process ) const;
+
+    public:
+        Scheduler();
+        virtual ~Scheduler();
+
+        /**
+         * @brief Creates scheduling policy.
+         *
+         * @param code Policy to create.
+         * @param settings Typed config of the simulation.
+         * @param clock Simulation timer service, source of time for stats.
+         * @return New policy, owned by caller.
+         */
+        static Scheduler *Create( SchedulingCode code, const SimConfig &settings, const TimerService &clock );
+
+        /**
+         * @brief Returns name of policy used in log.
+         */
+        virtual const char *Name( ) const = 0;
+
+        /**
+         * @brief Returns period of OnTick calls in ms, 0 if policy needs no ticks.
+         */
+        virtual unsigned long TickPeriod( ) const;
+
+        /**
+         * @brief Returns time in ms process may run once dispatched.
+         * @details Dispatcher calls OnTick once this time passes. 0 if
+         *          process runs until interrupted otherwise.
+         */
+        virtual unsigned long Quantum( PCB *process );
+
+        /**
+         * @brief Returns period of OnBoost calls in ms, 0 if policy needs no boost.
+         */
+        virtual unsigned long BoostPeriod( ) const;
+
+        /**
+         * @brief Called every BoostPeriod ms.
+         *
+         * @param epoch Number of boosts so far, same on every core.
+         */
+        virtual void OnBoost( unsigned long epoch );
+
+        /**
+         * @brief Adds runnable process, new, preempted or woken up.
+         */
+        void Enqueue( PCB *process );
+
+        /**
+         * @brief Removes process which should run next.
+         * @return Process, NULL if there are no runnable processes.
+         */
+        PCB *PickNext( );
+
+        /**
+         * @brief Called every TickPeriod ms while process runs, and once
+         *        its Quantum passed.
+         *
+         * @param running Process running on the core.
+         * @param ranMs Time in ms process ran since it was dispatched.
+         * @return True if process should be preempted.
+         */
+        bool OnTick( PCB *running, unsigned long ranMs );
+
+        /**
+         * @brief Called when process leaves the core to wait on IO.
+         */
+        virtual void OnBlock( PCB *process );
+
+        /**
+         * @brief Called when process finished IO, before it is enqueued.
+         */
+        void OnWake( PCB *process );
+
+        /**
+         * @brief Returns number of runnable processes.
+         */
+        virtual size_t Size( ) const = 0;
+
+        /**
+         * @brief Drops all processes and resets stats.
+         */
+        void Clear( );
+
+        /**
+         * @brief Returns cost of decisions made so far.
+         */
+        const SchedulerStats &Stats( ) const;
+
+        /**
+         * @brief Returns number of queues policy keeps processes in.
+         */
+        virtual size_t QueueCount( ) const;
+
+        /**
+         * @brief Returns quantum of a queue in ms, 0 if it has none.
+         */
+        virtual unsigned long QueueQuantum( size_t queue ) const;
+
+        /**
+         * @brief Returns residence and response time of a queue.
+         */
+        const QueueStats &Queue( size_t queue ) const;
+};
+
+/**
+ * @brief Round robin, processes run in arrival order until quantum expires.
+ *
+ */
+class RoundRobinScheduler : public Scheduler
+{
+    private:
+        std::deque<PCB *> queue;
+        unsigned long quantum;
+
+    protected:
+        void enqueue( PCB *process );
+        PCB *pickNext( );
+        bool onTick( PCB *running, unsigned long ranMs );
+        void clear( );
+
+    public:
+        RoundRobinScheduler( unsigned long quantum );
+        const char *Name( ) const;
+        unsigned long TickPeriod( ) const;
+        size_t Size( ) const;
+};
+
+/**
+ * @brief Shortest remaining time first, keyed by PCB remainingTime.
+ *
+ */
+class SrtfScheduler : public Scheduler
+{
+    private:
+        JobHeap heap;
+
+    protected:
+        void enqueue( PCB *process );
+        PCB *pickNext( );
+        void clear( );
+
+    public:
+        const char *Name( ) const;
+        size_t Size( ) const;
+};
+
+/**
+ * @brief Completely fair policy, runs process with the least virtual runtime.
+ * @details Runnable processes are kept in a balanced tree ordered by virtual
+ *          runtime. Running process is preempted on tick once it is no
+ *          longer the one with the least virtual runtime. Woken up processes
+ *          get at most half of the tick period of credit for time they slept.
+ *
+ */
+class CfsScheduler : public Scheduler
+{
+    private:
+        struct Entry
+        {
+            unsigned long vruntime;
+            unsigned long seq;
+            PCB *process;
+            bool operator<(const Entry &rhs) const
+            {
+                return vruntime != rhs.vruntime ? vruntime < rhs.vruntime : seq < rhs.seq;
+            }
+        };
+
+        std::set<Entry> tree;
+        unsigned long minVruntime;
+        unsigned long seqCounter;
+        unsigned long period;
+
+        /**
+         * @brief Adds CPU time process used since last update to its vruntime.
+         */
+        void update( PCB *process );
+
+    protected:
+        void enqueue( PCB *process );
+        PCB *pickNext( );
+        bool onTick( PCB *running, unsigned long ranMs );
+        void onWake( PCB *process );
+        void clear( );
+
+    public:
+        CfsScheduler( unsigned long period );
+        const char *Name( ) const;
+        unsigned long TickPeriod( ) const;
+        void OnBlock( PCB *process );
+        size_t Size( ) const;
+};
+
+/**
+ * @brief Multi-level feedback queue.
+ * @details Processes start in queue 0. Quantum doubles with every queue
+ *          below. Process using up its quantum moves one queue down,
+ *          process leaving for IO moves one queue up. Every boost period
+ *          all processes go back to queue 0, processes that aren't queued
+ *          at that moment are moved when they are enqueued next.
+ *
+ */
+class MlfqScheduler : public Scheduler
+{
+    private:
+        std::vector< std::deque<PCB *> > queues;
+        size_t count;
+        unsigned long quantum;
+        unsigned long boostPeriod;
+        unsigned long epoch;
+
+        /**
+         * @brief Adds CPU time process used since last update to used quantum.
+         */
+        void update( PCB *process );
+
+        /**
+         * @brief Moves process to queue 0, unless it already saw last boost.
+         */
+        void boost( PCB *process );
+
+    protected:
+        void enqueue( PCB *process );
+        PCB *pickNext( );
+        bool onTick( PCB *running, unsigned long ranMs );
+        void clear( );
+        size_t queueOf( PCB *process ) const;
+
+    public:
+        MlfqScheduler( size_t count, unsigned long quantum, unsigned long boostPeriod );
+        const char *Name( ) const;
+        unsigned long Quantum( PCB *process );
+        unsigned long BoostPeriod( ) const;
+        void OnBoost( unsigned long epoch );
+        void OnBlock( PCB *process );
+        size_t Size( ) const;
+        size_t QueueCount( ) const;
+        unsigned long QueueQuantum( size_t queue ) const;
+};
+
+#endif // _SCHEDULER
@@ -0,0 +1,44 @@
+#ifndef _SIM_CONFIG
+#define _SIM_CONFIG
+
+/**
+ * @brief Numeric config options, typed and checked.
+ * @details Filled once by Simulation::LoadConfig after the options are
+ *          validated and read-only from then on, so the simulation reads
+ *          cycle times and sizes as plain fields instead of looking them
+ *          up by label in ConfigManager on every event.
+ *
+ */
+struct SimConfig
+{
+    // Cycle times (msec)
+    unsigned long processorCycleMs;
+    unsigned long memoryCycleMs;
+    unsigned long monitorDisplayMs;
+    unsigned long hardDriveCycleMs;
+    unsigned long printerCycleMs;
+    unsigned long keyboardCycleMs;
+    unsigned long mouseCycleMs;
+    unsigned long speakerCycleMs;
+
+    // Memory
+    unsigned long systemMemoryKb;
+    unsigned long memoryBlockKb;
+    unsigned int tlbEntries;
+
+    // Resources
+    unsigned int printerQuantity;
+    unsigned int hardDriveQuantity;
+    unsigned int speakerQuantity;
+
+    // Scheduling
+    unsigned int cpuCount;
+    unsigned long quantumMs;
+    unsigned int mlfqQueueCount;
+    unsigned long mlfqBoostMs;
+
+    // Meta-data
+    unsigned int mdQueueDepth;
+};
+
+#endif // _SIM_CONFIG
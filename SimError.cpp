@@ -0,0 +1,14 @@
+#include "SimError.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+SimError::SimError( const char * format, ...)
+{
+    va_list args;
+    va_start( args, format );
+    vsnprintf( msg, sizeof msg, format, args );
+    va_end ( args );
+}
+
+char const * SimError::what() const throw () { return msg; }
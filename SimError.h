@@ -0,0 +1,36 @@
+#ifndef _SIM_ERROR
+#define _SIM_ERROR
+
+#include <exception>
+
+/**
+ * @brief An exception class used by Simulation class.
+ * @details Unlike exception provided by standard library,
+ *          this exception class allows for the message to
+ *          be formated using printf style.
+ * 
+ * @param format,... Structure of log output followed by arguments specified in structure.
+ * 
+ * @return Exception class
+ */
+class SimError : std::exception
+{
+    char msg[1024];
+    
+    public:
+        /**
+         * @brief Constructor for SimError exception class.
+         * @details Takes format and varargs to construct a message string.
+         * 
+         * @param format,... Structure of log output followed by arguments specified in structure.
+         */
+        SimError( char const * format, ... )
+            __attribute__ ((format(printf, 2, 3)));
+        /**
+         * @brief Returns exception message
+         * @return Exception message.
+         */
+        char const * what() const throw ();
+};
+
+#endif // _SIM_ERROR
@@ -1,21 +1,21 @@
 
 #include "Simulation.h"
 #include "helpers.h"
+#include "MetaDataParser.h"
 
 #include <vector>
-#include <unordered_set>
 #include <iostream>
 #include <string>
-#include <regex>
 #include <pthread.h>
 #include <climits>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
 
 using SimHelpers::strTrim;
-using SimHelpers::strSplit;
 using SimHelpers::strLower;
 
 using std::vector;
-using std::unordered_set;
 using std::queue;
 using std::fstream;
 using std::ios;
@@ -23,57 +23,119 @@ using std::getline;
 using std::string;
 using std::cout;
 using std::flush;
-using std::regex;
-using std::regex_search;
-using std::smatch;
 
-SimError::SimError( const char * format, ...)
+// Meta-data names of EventDescriptor values, in enum order
+static const char * const descriptorNames[] = {
+    "start", "end", "run", "hard drive", "keyboard", "mouse", "monitor", "speaker", "printer", "block", "allocate"
+};
+static_assert( sizeof descriptorNames / sizeof *descriptorNames == (size_t)EventDescriptor::COUNT,
+    "descriptorNames must name every EventDescriptor" );
+
+// Descriptors valid for an event code, as bitmask of EventDescriptor values
+static unsigned int validDescriptors( char code )
 {
-    va_list args;
-    va_start( args, format );
-    vsnprintf( msg, sizeof msg, format, args );
-    va_end ( args );
+    #define DESC(name) (1u << (unsigned int)EventDescriptor::name)
+    switch(code)
+    {
+        case 'S': return DESC(START) | DESC(END);
+        case 'A': return DESC(START) | DESC(END);
+        case 'P': return DESC(RUN);
+        case 'I': return DESC(HARD_DRIVE) | DESC(KEYBOARD) | DESC(MOUSE);
+        case 'O': return DESC(HARD_DRIVE) | DESC(MONITOR) | DESC(SPEAKER) | DESC(PRINTER);
+        case 'M': return DESC(BLOCK) | DESC(ALLOCATE);
+        default:  return 0;
+    }
+    #undef DESC
+}
+
+// ms of processing time of event, IO doesn't count
+static unsigned long eventWork( const SimEvent &event, unsigned long processorMs, unsigned long memoryMs )
+{
+    if( event.code == 'P' )
+        return event.cycles * processorMs;
+    if( event.code == 'M' )
+        return event.cycles * memoryMs;
+    return 0;
 }
 
-char const * SimError::what() const throw () { return msg; }
+const char * DescriptorName( EventDescriptor descriptor )
+{
+    return descriptorNames[(size_t)descriptor];
+}
 
-Simulation::Simulation( const string &configFile )
+// Config options of the simulation, ranges are checked by ConfigManager::Validate
+// Values of enumerated options, LoadConfig maps them
+static constexpr std::string_view logValues[]           = { "Log to Both", "Log to File", "Log to Monitor" };
+static constexpr std::string_view schedulingCodes[]     = { "RR", "STR", "SRT", "SRTF", "CFS", "MLFQ" };
+static constexpr std::string_view clockValues[]         = { "Real", "Virtual" };
+static constexpr std::string_view remainingTimeValues[] = { "Events", "Time" };
+static constexpr std::string_view memoryModeValues[]    = { "Physical", "Virtual" };
+static constexpr std::string_view replacementValues[]   = { "FIFO", "LRU", "CLOCK" };
+static constexpr std::string_view overflowValues[]      = { "Block", "Drop" };
+static constexpr std::string_view logFormatValues[]     = { "Text", "Binary" };
+static constexpr std::string_view logLevelValues[]      = { "None", "Summary", "Info", "Detail" };
+static constexpr std::string_view logCategoryValues[]   = { "All", "OS", "Process", "Memory", "Device", "Scheduler" };
+static constexpr std::string_view loadingValues[]       = { "Full", "Stream" };
+static constexpr std::string_view onOffValues[]         = { "On", "Off" };
+
+static constexpr ConfigOptionSpec configOptions[] = {
+    ConfigRequired( "Version/Phase",                  ConfigType::Double ),
+    ConfigRequired( "File Path",                      ConfigType::String ),
+    ConfigRequired( "Processor cycle time (msec)",    ConfigType::Int,    1 ),
+    ConfigRequired( "Monitor display time (msec)",    ConfigType::Int,    1 ),
+    ConfigRequired( "Hard drive cycle time (msec)",   ConfigType::Int,    1 ),
+    ConfigRequired( "Printer cycle time (msec)",      ConfigType::Int,    1 ),
+    ConfigRequired( "Keyboard cycle time (msec)",     ConfigType::Int,    1 ),
+    ConfigDefault(  "Mouse cycle time (msec)",        ConfigType::Int,    "1", 1 ),
+    ConfigDefault(  "Speaker cycle time (msec)",      ConfigType::Int,    "1", 1 ),
+    ConfigRequired( "Memory cycle time (msec)",       ConfigType::Int,    1 ),
+    ConfigRequired( "Log",                            logValues ),
+    ConfigRequired( "Log File Path",                  ConfigType::String ),
+    ConfigRequired( "Printer quantity",               ConfigType::Int    ),
+    ConfigDefault(  "Hard drive quantity",            ConfigType::Int,    "1" ),
+    ConfigDefault(  "Speaker quantity",               ConfigType::Int,    "1" ),
+    ConfigRequired( "Quantum Number (msec)",          ConfigType::Int,    1 ),
+    ConfigRequired( "Memory block size (kbytes)",     ConfigType::Int,    1 ),
+    ConfigRequired( "System memory (kbytes)",         ConfigType::Int,    1 ),
+    ConfigDefault(  "System memory (Mbytes)",         ConfigType::Int,    "0" ),
+    ConfigDefault(  "System memory (Gbytes)",         ConfigType::Int,    "0" ),
+    ConfigRequired( "CPU Scheduling Code",            schedulingCodes ),
+    ConfigDefault(  "Simulation Clock",               clockValues,         "Real" ),
+    ConfigDefault(  "SRTF Remaining Time",            remainingTimeValues, "Events" ),
+    ConfigDefault(  "CPU count",                      ConfigType::Int,    "1", 1 ),
+    ConfigDefault(  "MLFQ Queue Count",               ConfigType::Int,    "3", 1, 16 ),
+    ConfigDefault(  "MLFQ Boost Period (msec)",       ConfigType::Int,    "1000", 1 ),
+    ConfigDefault(  "Memory Mode",                    memoryModeValues,    "Physical" ),
+    ConfigDefault(  "Page Replacement",               replacementValues,   "FIFO" ),
+    ConfigDefault(  "TLB Entries",                    ConfigType::Int,    "16", 1 ),
+    ConfigDefault(  "Log Overflow",                   overflowValues,      "Block" ),
+    ConfigDefault(  "Log Format",                     logFormatValues,     "Text" ),
+    ConfigDefault(  "Log Level",                      logLevelValues,      "Detail" ),
+    ConfigDefault(  "Log Categories",                 logCategoryValues,   "All", true ),
+    ConfigDefault(  "Meta-Data Loading",              loadingValues,       "Full" ),
+    ConfigDefault(  "Meta-Data Queue Depth",          ConfigType::Int,    "64", 1 ),
+    ConfigDefault(  "Meta-Data Threads",              ConfigType::Int,    "1", 1 ),
+    ConfigDefault(  "Meta-Data Cache",                onOffValues,         "Off" ),
+};
+static const ConfigSchema configSchema( configOptions );
+
+// Meta-data smaller than this is read by one thread whatever Meta-Data Threads is
+static const size_t PARALLEL_META_DATA_SIZE = 1 << 20;
+static const size_t META_DATA_PARTS_PER_THREAD = 4;
+
+// Loader creates a process of every application this many times, 100 ms apart
+static const unsigned int LOADER_ROUNDS = 10;
+
+// Streamed programs are loaded a queue depth of them at a time, this far apart on virtual clock
+static const unsigned long STREAM_BATCH_MS = 1;
+
+// Core simulated by the calling dispatcher thread
+static thread_local SimCore *runningCore = NULL;
+
+Simulation::Simulation( const string &configFile ) : config( configSchema )
 {
-    processes.resize(4096);
     pthread_mutex_init(&simMutex, NULL);
-    pthread_mutex_init(&logMutex, NULL);
-
-    memoryBlockCounter = 0;
-
-    config.AddOption( "Version/Phase",                  ConfigType::Double );
-    config.AddOption( "File Path",                      ConfigType::String );
-    config.AddOption( "Processor cycle time (msec)",    ConfigType::Int    );
-    config.AddOption( "Monitor display time (msec)",    ConfigType::Int    );
-    config.AddOption( "Hard drive cycle time (msec)",   ConfigType::Int    );
-    config.AddOption( "Printer cycle time (msec)",      ConfigType::Int    );
-    config.AddOption( "Keyboard cycle time (msec)",     ConfigType::Int    );
-    config.AddOption( "Mouse cycle time (msec)",        ConfigType::Int    );
-    config.AddOption( "Speaker cycle time (msec)",      ConfigType::Int    );
-    config.AddOption( "Memory cycle time (msec)",       ConfigType::Int    );
-    config.AddOption( "Log",                            ConfigType::String );
-    config.AddOption( "Log File Path",                  ConfigType::String );
-    config.AddOption( "Printer quantity",               ConfigType::Int    );
-    config.AddOption( "Hard drive quantity",            ConfigType::Int    );
-    config.AddOption( "Speaker quantity",               ConfigType::Int    );
-    config.AddOption( "Quantum Number (msec)",          ConfigType::Int    );
-    config.AddOption( "Memory block size (kbytes)",     ConfigType::Int    );
-    config.AddOption( "System memory (kbytes)",         ConfigType::Int    );
-    config.AddOption( "System memory (Mbytes)",         ConfigType::Int    );
-    config.AddOption( "System memory (Gbytes)",         ConfigType::Int    );
-    config.AddOption( "CPU Scheduling Code",            ConfigType::String );
-
-    // Default values
-    config.SetInt( "Mouse cycle time (msec)", 1 );
-    config.SetInt( "Speaker cycle time (msec)", 1 );
-    config.SetInt( "System memory (Mbytes)", 0 );
-    config.SetInt( "Speaker quantity", 1 );
-    config.SetInt( "Hard drive quantity", 1 );
-    config.SetInt( "System memory (Gbytes)", 0 );
+    pthread_mutex_init(&memMutex, NULL);
 
 	ReadConfigFile( configFile );
 	LoadConfig( );
@@ -83,6 +145,12 @@ Simulation::Simulation( const string &configFile )
 }
 Simulation::~Simulation( )
 {
+    if( mdReaderRunning )
+    {
+        streamedPrograms.Cancel();
+        pthread_join( mdReader, NULL );
+    }
+    logger.Stop();
     if ( logFile.is_open() )
         logFile.close();
 
@@ -92,26 +160,85 @@ Simulation::~Simulation( )
     if(resKeyboard) delete resKeyboard;
     if(resMouse)    delete resMouse;
     if(resSpeaker)  delete resSpeaker;
+
+    for( SimCore *core : cores )
+        delete core;
+    // Cached programs are owned by cachedPrograms
+    if( cachedPrograms.empty() )
+        for( Program *program : applications )
+            delete program;
 }
 
 void Simulation::Log( char const * format, ... )
 {
-    pthread_mutex_lock(&logMutex);
-
     char msg[1024];
 
     va_list args;
     va_start( args, format );
-    vsnprintf( msg, sizeof msg, format, args );
+    int length = vsnprintf( msg, sizeof msg, format, args );
     va_end ( args );
 
-    if( logToMonitor )
-        cout << msg << flush;
-    
-    if( logToFile )
-        logFile << msg << flush;
+    if( length < 0 )
+        return;
+    length = std::min( (size_t)length, sizeof msg - 1 );
 
-    pthread_mutex_unlock(&logMutex);
+    if( binaryLog )
+    {
+        // Text record followed by the text, cut to what fits one logger record
+        const size_t maxRecords = (AsyncLogger::RECORD_SIZE - 1) / sizeof(TraceRecord) - 1;
+        static_assert( (maxRecords + 1) * sizeof(TraceRecord) <= AsyncLogger::RECORD_SIZE - 1,
+            "Text record must fit one logger record" );
+        TraceRecord records[maxRecords + 1];
+        length = std::min( (size_t)length, maxRecords * sizeof(TraceRecord) );
+        records[0] = TraceRecord{ 0, 0, 0, TraceEvent::TEXT, TraceDevice::COUNT, TRACE_NO_CORE, (uint32_t)length, 0 };
+        memcpy( &records[1], msg, length );
+        logger.Write( (const char *)records, TraceRecordCount( records[0] ) * sizeof(TraceRecord) );
+        return;
+    }
+    logger.Write( msg, length );
+}
+
+void Simulation::Trace( TraceRecord *records )
+{
+    records[0].time = simNow();
+    size_t count = TraceRecordCount( records[0] );
+    if( binaryLog )
+    {
+        logger.Write( (const char *)records, count * sizeof(TraceRecord) );
+        return;
+    }
+
+    char line[512];
+    int length = FormatTrace( line, sizeof line, records );
+    if( length < 0 )
+        return;
+    logger.Write( line, std::min( (size_t)length, sizeof line - 1 ) );
+}
+
+void Simulation::Trace( TraceEvent event, unsigned int pid, uint16_t core, TraceDevice device, unsigned int unit, unsigned long address )
+{
+    TraceRecord record = { 0, address, pid, event, device, core, unit, 0 };
+    Trace( &record );
+}
+
+void Simulation::trace( TraceEvent event, unsigned int pid, const SimCore &core, unsigned long address, unsigned int unit )
+{
+    TraceRecord record = { 0, address, pid, event, TraceDevice::COUNT, traceCore(core), unit, 0 };
+    Trace( &record );
+}
+
+void Simulation::tracePageFault( const SimCore &core, unsigned int pid, unsigned long page, const PageFault &fault )
+{
+    if(!fault.evicted){
+        trace( TraceEvent::PAGE_FAULT, pid, core, page, fault.frame );
+        return;
+    }
+
+    TraceRecord records[2] = {
+        { 0, page, pid, TraceEvent::PAGE_FAULT_EVICT, TraceDevice::COUNT, traceCore(core), (uint32_t)fault.frame, 0 },
+        { 0, fault.victimPage, fault.victimPid, TraceEvent::PAGE_EVICTED, TraceDevice::COUNT, TRACE_NO_CORE, 0, 0 }
+    };
+    Trace( records );
 }
 
 void Simulation::ReadConfigFile( const string &configFile )
@@ -125,41 +252,34 @@ void Simulation::ReadConfigFile( const string &configFile )
     if(!fl.is_open())    
         throw SimError( "Unable to open config file: %s", configFile.c_str() );
 
+    // Config header is the first line
     string line;
-    // Skip to config header
-    while(getline(fl, line))
-    {
-        if(strTrim(line) == configHeader);
-            break;
-    }
+    getline(fl, line);
     if( line != configHeader )
         throw SimError( "Config header is missing!" );
     
     // Read the config
-    string key;
-    string val;
-    
-    regex rConfigLine(R"(^\s*([\S\t ]*?)\s*:\s*([\S\t ]+?)\s*$)");
-    regex rEmptyLine(R"(^\s*$)");
-    
+    std::string_view key;
+    std::string_view val;
+
     while( getline(fl, line) )
     {
         line = strTrim(line);
         if( line == configFooter )
             break;
 
-        smatch sm;        
-        if( !regex_search(line, sm, rConfigLine) )
+        if( !ConfigManager::ParseLine( line, key, val ) )
         {
-            if( !regex_search(line, sm, rEmptyLine) )
+            if( line.find_first_not_of( " \t\n\v\f\r" ) != string::npos )
                 throw SimError( "Unable to parse config line: %s", line.c_str() );
             continue;
         }
 
-        key = sm.str(1);
-        val = sm.str(2);
-
-        configKeyValues.insert({key, val});
+        // First value of an option counts
+        auto set = std::find_if( configKeyValues.begin(), configKeyValues.end(),
+            [&]( const std::pair<string, string> &option ) { return option.first == key; } );
+        if( set == configKeyValues.end() )
+            configKeyValues.emplace_back( key, val );
     }
     fl.close();
 
@@ -174,59 +294,108 @@ void Simulation::LoadConfig( )
         config.SetStr(it->first, it->second);
 
         if( it->first == "System memory (Mbytes)" )
-            config.SetInt( "System memory (kbytes)", (long int)config.GetInt("System memory (Mbytes)") * 10e3 );
+            config.SetInt( "System memory (kbytes)", config.GetInt("System memory (Mbytes)") * 1024 );
         else if( it->first == "System memory (Gbytes)" )
-            config.SetInt( "System memory (kbytes)", (long int)config.GetInt("System memory (Gbytes)") * 10e6 );
-    }
-
-    // Check if all config options are initialized
-    vector<string> labels;
-    config.GetOptionLabels( labels );
-    for( auto it = labels.begin(); it != labels.end(); it++ )
-    {
-        if( !config.OptionInitialized( *it ) )
-            throw SimError( "\"%s\" config option is not initialized", (*it).c_str() );
-    }
-
-    // Check if times are at least 1
-    if( config.GetInt( "Processor cycle time (msec)" ) < 1 )
-        throw SimError( "Processor cycle time (msec) must be at least 1." );
-    if( config.GetInt( "Monitor display time (msec)" ) < 1 )
-        throw SimError( "Monitor display time (msec) must be at least 1." );
-    if( config.GetInt( "Hard drive cycle time (msec)" ) < 1 )
-        throw SimError( "Hard drive cycle time (msec) must be at least 1." );
-    if( config.GetInt( "Printer cycle time (msec)" ) < 1 )
-        throw SimError( "Printer cycle time (msec) must be at least 1." );
-    if( config.GetInt( "Keyboard cycle time (msec)" ) < 1 )
-        throw SimError( "Keyboard cycle time (msec) must be at least 1." );
-    if( config.GetInt( "Mouse cycle time (msec)" ) < 1 )
-        throw SimError( "Mouse cycle time (msec) must be at least 1." );
-    if( config.GetInt( "Speaker cycle time (msec)" ) < 1 )
-        throw SimError( "Speaker cycle time (msec) must be at least 1." );
-    if( config.GetInt( "Memory cycle time (msec)" ) < 1 )
-        throw SimError( "Memory cycle time (msec) must be at least 1." );
-    if( config.GetInt( "System memory (kbytes)" ) < 1 )
-        throw SimError( "System memory must be at least 1 kbytes." );
-    if( config.GetInt( "Memory block size (kbytes)" ) < 1 )
-        throw SimError( "Memory block size must be at least 1 kbytes." );
+            config.SetInt( "System memory (kbytes)", config.GetInt("System memory (Gbytes)") * 1024 * 1024 );
+    }
+
+    // Check that all config options are set and within their ranges
+    try
+    {
+        config.Validate();
+    }
+    catch( const std::runtime_error &e )
+    {
+        throw SimError( "%s", e.what() );
+    }
 
+    // Enumerated options are checked against their values, map them
     // Set scheduling algorithm
-    string s_scheduling = config.GetStr("CPU Scheduling Code");
-    if( s_scheduling == "RR" )
+    string s_scheduling = strLower( config.GetStr("CPU Scheduling Code") );
+    if( s_scheduling == "rr" )
         scheduling = SchedulingCode::RR;
-    else if( s_scheduling == "STR" ) // Shortest Time Remaining
-        scheduling = SchedulingCode::SRTF;
-    else if( s_scheduling == "SRT" ) // Shortest Remaining Time
-        scheduling = SchedulingCode::SRTF;
-    else if( s_scheduling == "SRTF" ) // Shortest Remaining Time First
+    else if( s_scheduling == "cfs" ) // Completely Fair Scheduler
+        scheduling = SchedulingCode::CFS;
+    else if( s_scheduling == "mlfq" ) // Multi-Level Feedback Queue
+        scheduling = SchedulingCode::MLFQ;
+    else // STR, SRT or SRTF, Shortest Remaining Time First
         scheduling = SchedulingCode::SRTF;
+
+    // Set how SRTF measures remaining work
+    if( strLower( config.GetStr("SRTF Remaining Time") ) == "events" )
+        remainingTimeMode = RemainingTimeMode::EVENTS;
+    else
+        remainingTimeMode = RemainingTimeMode::TIME;
+
+    // Set simulation clock and memory mode
+    virtualTime = strLower( config.GetStr("Simulation Clock") ) == "virtual";
+    virtualMemory = strLower( config.GetStr("Memory Mode") ) == "virtual";
+
+    // Set meta-data loading
+    streamMetaData = strLower( config.GetStr("Meta-Data Loading") ) == "stream";
+    if( streamMetaData && config.GetInt( "Meta-Data Threads" ) != 1 )
+        throw SimError( "Streamed meta-data is read by 1 thread." );
+    mdThreads = config.GetInt( "Meta-Data Threads" );
+
+    mdCache = strLower( config.GetStr("Meta-Data Cache") ) == "on";
+    if( streamMetaData && mdCache )
+        throw SimError( "Streamed meta-data is not cached." );
+
+    string s_replacement = strLower( config.GetStr("Page Replacement") );
+    if( s_replacement == "fifo" )
+        pageReplacement = PageReplacement::FIFO;
+    else if( s_replacement == "lru" )
+        pageReplacement = PageReplacement::LRU;
     else
-        throw SimError( "\"%s\" is an invalid scheduling code. Possible scheduling codes are RR and SRTF.", s_scheduling.c_str() );
+        pageReplacement = PageReplacement::CLOCK;
+
+    // Create CPU cores
+    if( virtualTime && config.GetInt( "CPU count" ) != 1 )
+        throw SimError( "Virtual simulation clock supports only 1 CPU." );
+
+    // Options are checked, the simulation reads them typed from here on
+    settings.processorCycleMs  = config.GetInt( "Processor cycle time (msec)" );
+    settings.memoryCycleMs     = config.GetInt( "Memory cycle time (msec)" );
+    settings.monitorDisplayMs  = config.GetInt( "Monitor display time (msec)" );
+    settings.hardDriveCycleMs  = config.GetInt( "Hard drive cycle time (msec)" );
+    settings.printerCycleMs    = config.GetInt( "Printer cycle time (msec)" );
+    settings.keyboardCycleMs   = config.GetInt( "Keyboard cycle time (msec)" );
+    settings.mouseCycleMs      = config.GetInt( "Mouse cycle time (msec)" );
+    settings.speakerCycleMs    = config.GetInt( "Speaker cycle time (msec)" );
+    settings.systemMemoryKb    = config.GetInt( "System memory (kbytes)" );
+    settings.memoryBlockKb     = config.GetInt( "Memory block size (kbytes)" );
+    settings.tlbEntries        = config.GetInt( "TLB Entries" );
+    settings.printerQuantity   = config.GetInt( "Printer quantity" );
+    settings.hardDriveQuantity = config.GetInt( "Hard drive quantity" );
+    settings.speakerQuantity   = config.GetInt( "Speaker quantity" );
+    settings.cpuCount          = config.GetInt( "CPU count" );
+    settings.quantumMs         = config.GetInt( "Quantum Number (msec)" );
+    settings.mlfqQueueCount    = config.GetInt( "MLFQ Queue Count" );
+    settings.mlfqBoostMs       = config.GetInt( "MLFQ Boost Period (msec)" );
+    settings.mdQueueDepth      = config.GetInt( "Meta-Data Queue Depth" );
+
+    unsigned int cpuCount = settings.cpuCount;
+    for( unsigned int i = 0; i < cpuCount; ++i )
+    {
+        SimCore *core = new SimCore();
+        core->sim = this;
+        core->id = i;
+        if( cpuCount > 1 )
+            snprintf( core->label, sizeof core->label, " on CPU %u", i );
+        else
+            core->label[0] = '\0';
+        core->jobs.SetScheduler( Scheduler::Create( scheduling, settings, timers ) );
+        cores.push_back(core);
+    }
 
     // Calculate max of memory blocks
-    maxMemoryBlocks = config.GetInt( "System memory (kbytes)" ) / config.GetInt( "Memory block size (kbytes)" );
+    maxMemoryBlocks = settings.systemMemoryKb / settings.memoryBlockKb;
+    if( virtualMemory && maxMemoryBlocks < 1 )
+        throw SimError( "System memory must hold at least 1 memory block for virtual memory." );
 
     // Initialize logs
+    binaryLog = strLower( config.GetStr("Log Format") ) == "binary";
+
     string log = strLower( config.GetStr("Log") );
     if( log == "log to both" )
     {
@@ -239,157 +408,466 @@ void Simulation::LoadConfig( )
         logToMonitor = false;
 
     }
-    else if( log == "log to monitor" )
+    else
     {
         logToFile = false;
         logToMonitor = true;
     }
+    if( binaryLog && logToMonitor )
+        throw SimError( "Binary log format requires Log to File." );
+
+    string level = strLower( config.GetStr("Log Level") );
+    if( level == "none" )
+        logLevel = LogLevel::NONE;
+    else if( level == "summary" )
+        logLevel = LogLevel::SUMMARY;
+    else if( level == "info" )
+        logLevel = LogLevel::INFO;
     else
+        logLevel = LogLevel::DETAIL;
+
+    logCategories = 0;
+    std::stringstream categories( strLower( config.GetStr("Log Categories") ) );
+    string category;
+    while( getline( categories, category, ',' ) )
     {
-        throw SimError( "Log config option is invalid: %s", config.GetStr("Log").c_str() );
+        category = strTrim( category );
+        if( category == "all" )
+            logCategories |= (1u << (unsigned int)LogCategory::COUNT) - 1;
+        else if( category == "os" )
+            logCategories |= 1u << (unsigned int)LogCategory::OS;
+        else if( category == "process" )
+            logCategories |= 1u << (unsigned int)LogCategory::PROCESS;
+        else if( category == "memory" )
+            logCategories |= 1u << (unsigned int)LogCategory::MEMORY;
+        else if( category == "device" )
+            logCategories |= 1u << (unsigned int)LogCategory::DEVICE;
+        else if( category == "scheduler" )
+            logCategories |= 1u << (unsigned int)LogCategory::SCHEDULER;
     }
     
     if( logToFile )
     {
         string logFilePath = config.GetStr("Log File Path");
 
-        logFile.open( logFilePath, ios::out );
+        logFile.open( logFilePath, binaryLog ? ios::out | ios::binary : ios::out );
         if( !logFile.is_open() )    
             throw SimError( "Unable to open log file: %s", logFilePath.c_str() );
     }
 
-    //Initialize resources
+    LogOverflow logOverflow;
+    if( strLower( config.GetStr("Log Overflow") ) == "drop" )
+        logOverflow = LogOverflow::DROP;
+    else
+        logOverflow = LogOverflow::BLOCK;
+    if( binaryLog )
+    {
+        // Header goes first, trace lines are encoded by the writer in the order it writes them
+        TraceHeader header = MakeTraceHeader();
+        logFile.write( (const char *)&header, sizeof header );
+        traceEncoder = TraceEncoder();
+        static_assert( AsyncLogger::RECORD_SIZE + TRACE_ENCODED_SLACK <= AsyncLogger::ENCODED_SIZE,
+            "Encoded trace line must fit logger buffer" );
+        logger.Start( NULL, &logFile, logOverflow, [this]( const char *record, size_t length, char *out ){
+            TraceRecord records[AsyncLogger::RECORD_SIZE / sizeof(TraceRecord)];
+            memcpy( records, record, length );
+            return traceEncoder.Encode( records, out );
+        });
+    }
+    else
+        logger.Start( logToMonitor ? &cout : NULL, logToFile ? &logFile : NULL, logOverflow );
 
-    config.AddOption( "Printer quantity",               ConfigType::Int    );
-    config.AddOption( "Hard drive quantity",            ConfigType::Int    );
+    //Initialize resources
 
-    resPrinter  = new ResourcePrinter(  this, config.GetInt( "Printer quantity" ),      config.GetInt( "Printer cycle time (msec)" ) );
-    resHdd      = new ResourceHDD(      this, config.GetInt( "Hard drive quantity" ),   config.GetInt( "Hard drive cycle time (msec)" ) );
-    resSpeaker  = new ResourceSpeaker(  this, config.GetInt( "Speaker quantity" ),      config.GetInt( "Speaker cycle time (msec)" ) );
-    resMonitor  = new ResourceMonitor(  this, config.GetInt( "Monitor display time (msec)" ) );
-    resKeyboard = new ResourceKeyboard( this, config.GetInt( "Keyboard cycle time (msec)" ) );
-    resMouse    = new ResourceMouse(    this, config.GetInt( "Mouse cycle time (msec)" ) );
+    resPrinter  = new ResourcePrinter(  this, settings.printerQuantity,   settings.printerCycleMs );
+    resHdd      = new ResourceHDD(      this, settings.hardDriveQuantity, settings.hardDriveCycleMs );
+    resSpeaker  = new ResourceSpeaker(  this, settings.speakerQuantity,   settings.speakerCycleMs );
+    resMonitor  = new ResourceMonitor(  this, settings.monitorDisplayMs );
+    resKeyboard = new ResourceKeyboard( this, settings.keyboardCycleMs );
+    resMouse    = new ResourceMouse(    this, settings.mouseCycleMs );
+
+    // IO events pick their resource by descriptor
+    for( size_t i = 0; i < (size_t)EventDescriptor::COUNT; ++i )
+        ioResources[i] = NULL;
+    ioResources[(size_t)EventDescriptor::HARD_DRIVE] = resHdd;
+    ioResources[(size_t)EventDescriptor::MONITOR]    = resMonitor;
+    ioResources[(size_t)EventDescriptor::PRINTER]    = resPrinter;
+    ioResources[(size_t)EventDescriptor::KEYBOARD]   = resKeyboard;
+    ioResources[(size_t)EventDescriptor::MOUSE]      = resMouse;
+    ioResources[(size_t)EventDescriptor::SPEAKER]    = resSpeaker;
 }
 
 void Simulation::ReadMetaData( )
 {
     const string mdFile = config.GetStr("File Path");
-    const string mdHeader = "Start Program Meta-Data Code:";
-    const string mdFooter = "End Program Meta-Data Code.";
-    
-    fstream  fl;
-    fl.open( mdFile, ios::in );
-    if(!fl.is_open())    
+
+    if( !mdParser.Open( mdFile ) )
         throw SimError( "Unable to open meta-data file: %s", mdFile.c_str() );
-    
-    string line;
 
-    // Extract lines between meta-data header and footer
-    string mdStr = "";
-        
-    while(getline(fl, line))
+    // Streamed meta-data is read by MetaDataReader
+    if( streamMetaData )
+        return;
+
+    // Cache written by an earlier run from the same meta-data saves parsing it
+    string cachePath;
+    uint64_t hash = 0;
+    if( mdCache )
     {
-        line = strTrim(line);
-        if(line == mdHeader);
-            break;
+        cachePath = MetaDataCache::PathOf( mdFile );
+        hash = mdParser.Hash();
+        if( loadMetaDataCache( cachePath, hash ) )
+        {
+            mdParser.Close();
+            return;
+        }
     }
-    if( line != mdHeader )
-        throw SimError( "Meta-Data header is missing!" );
-    
-    
-    while(getline(fl, line))
+
+    parseMetaData();
+
+    // Run goes on without cache if it can't be written
+    if( mdCache )
+        MetaDataCache::Write( cachePath, mdParser.Size(), hash, applications );
+    mdParser.Close();
+}
+
+bool Simulation::loadMetaDataCache( const string &path, uint64_t hash )
+{
+    if( !mdCacheFile.Open( path, mdParser.Size(), hash ) )
+        return false;
+
+    // Programs read their events from the mapped cache
+    unsigned long processorMs = settings.processorCycleMs;
+    unsigned long memoryMs = settings.memoryCycleMs;
+    cachedPrograms.resize( mdCacheFile.ProgramCount() );
+    applications.resize( cachedPrograms.size() );
+    for( size_t i = 0; i < cachedPrograms.size(); ++i )
     {
-        line = strTrim(line);
-        if(line == mdFooter)
-            break;
-        mdStr += line;
+        const MetaDataCacheProgram &entry = mdCacheFile.Entry( i );
+        Program &program = cachedPrograms[i];
+        program.eventData = mdCacheFile.Events( entry );
+        program.eventCount = entry.eventCount;
+        program.workTime = 0;
+        applications[i] = &program;
+
+        // Events are checked as if parsed, a corrupt cache is parsed over
+        for( size_t j = 0; j < program.eventCount; ++j )
+        {
+            const SimEvent &event = program.eventData[j];
+            unsigned int valid = event.code == 'S' || event.code == 'A' ? 0 : validDescriptors( event.code );
+            if( event.descriptor >= EventDescriptor::COUNT || !(valid & (1u << (unsigned int)event.descriptor)) )
+            {
+                applications.clear();
+                cachedPrograms.clear();
+                mdCacheFile.Close();
+                return false;
+            }
+            program.workTime += eventWork( event, processorMs, memoryMs );
+        }
     }
-    fl.close();
-
-    if( line != mdFooter )
-        throw SimError( "Meta-Data footer is missing!" );
-    
-    if( mdStr.back() != '.' )
-        throw SimError( "Meta-Data is missing period at the end of events!" );
-    mdStr.pop_back();
-    
-    // Read meta-data events and populate queue
-    vector<string> tokens;
-    strSplit( mdStr, ';', tokens );
-    
-    regex rEvent(R"(^\s*([A-Z])\s*\(\s*([a-z\s]*)\s*\)\s*(\d+)\s*$)");
-    smatch sm;
+    return true;
+}
 
+void Simulation::parseMetaData( )
+{
+    // Read meta-data events and populate programs
     currentApplication = NULL;
     osRunning = false;
 
-    string eventDescriptor;
-    for( auto it = tokens.begin(); it != tokens.end(); it++)
+    // Large meta-data is read in parallel, invalid one again by this thread for the first error
+    bool parallel = !streamMetaData && mdThreads > 1 && mdParser.Size() >= PARALLEL_META_DATA_SIZE;
+    if( !parallel || !parseMetaDataParallel( mdThreads ) )
     {
-        char eventCode;
-        long int eventCycles;
-
-        if( !regex_search(*it, sm, rEvent) )
-            throw SimError("Unable to parse following event: %s", (*it).c_str());
-        eventCode = sm.str(1)[0];
-        eventDescriptor = sm.str(2);
-        eventCycles = strtol(sm.str(3).c_str(), NULL, 10);
-
-        AddEvent( eventCode, eventDescriptor, eventCycles );
-
+        try
+        {
+            mdParser.Parse( [this]( char code, std::string_view descriptor, long int cycles ) {
+                AddEvent( code, descriptor, cycles );
+            } );
+        }
+        catch( const MetaDataError &e )
+        {
+            throw SimError( "%s", e.what() );
+        }
     }
+
     if(currentApplication)
         throw SimError( "Missing meta-data to end last process." );
     if(osRunning)
         throw SimError( "Missing meta-data to end OS." );
 }
 
-void Simulation::AddEvent( char code, string &descriptor, long int cycles )
+/**
+ * @brief Part of meta-data parsed by one thread of parallel read.
+ * @details Whether an application is open where the part starts is only
+ *          known once parts before it are merged, events before the first
+ *          S or A event of the part are kept for the application open then.
+ *          Applications started in the part are built by its thread.
+ * 
+ */
+struct MetaDataPart
 {
-    // Check if event is valid
-    unordered_set<string> validDescriptors;
-    switch(code)
+    size_t begin;
+    size_t end;
+    MetaDataChunk chunk;
+    std::vector<SimEvent> head;                         // Events before the first S or A event
+    unsigned long headWork;
+    std::vector<std::pair<SimEvent, Program *>> marks;  // S and A events, with program A(start) starts
+};
+
+/**
+ * @brief Parts of parallel meta-data read shared by its threads.
+ * 
+ */
+struct MetaDataRead
+{
+    Simulation *sim;
+    std::vector<MetaDataPart> *parts;
+    std::atomic<size_t> next;
+};
+
+bool Simulation::parseMetaDataParallel( unsigned int threads )
+{
+    size_t body = mdParser.Body();
+    if( body == string::npos )
+        return false;
+
+    // Parts end on line starts, a few per thread so threads finish together
+    vector<MetaDataPart> parts;
+    size_t count = threads * META_DATA_PARTS_PER_THREAD;
+    size_t begin = body;
+    for( size_t i = 1; i <= count; ++i )
     {
-        case 'S': validDescriptors = { "start", "end" }; break;
-        case 'A': validDescriptors = { "start", "end" }; break;
-        case 'P': validDescriptors = { "run" }; break;
-        case 'I': validDescriptors = { "hard drive", "keyboard", "mouse" }; break;
-        case 'O': validDescriptors = { "hard drive", "monitor", "speaker", "printer" }; break;
-        case 'M': validDescriptors = { "block", "allocate" }; break;
-        default:
-            throw SimError( "%c(%s)%ld Unknown event code for meta-data event.", code, descriptor.c_str(), cycles );
+        size_t end = i == count ? mdParser.Size() : mdParser.LineStart( body + (mdParser.Size() - body) / count * i );
+        if( end <= begin )
+            continue;
+        parts.emplace_back();
+        parts.back().begin = begin;
+        parts.back().end = end;
+        parts.back().headWork = 0;
+        begin = end;
     }
-    if( validDescriptors.find(descriptor) == validDescriptors.end() )
-        throw SimError( "%c(%s)%ld Invalid descriptor for meta-data event.", code, descriptor.c_str(), cycles );
-    if( cycles < 0 )
-        throw SimError( "%c(%s)%ld Invalid cycles for meta-data event.", code, descriptor.c_str(), cycles );
-    SimEvent event = {code, descriptor, cycles};
+
+    MetaDataRead read;
+    read.sim = this;
+    read.parts = &parts;
+    read.next = 0;
+    // Workers take parts until none is left, so read goes on with the threads
+    // started if one can't be, they are joined before read and parts go away
+    vector<pthread_t> workers( threads - 1 );
+    size_t started = 0;
+    while( started < workers.size()
+        && pthread_create(&workers[started], NULL, Simulation::MetaDataWorker, &read) == 0 )
+        ++started;
+    MetaDataWorker( &read );
+    for( size_t i = 0; i < started; ++i )
+        pthread_join(workers[i], NULL);
+
+    bool merged;
+    try
+    {
+        merged = mergeParts( parts );
+    }
+    catch( const SimError & )
+    {
+        merged = false;
+    }
+    if( merged )
+        return true;
+
+    // Drop everything read, every program is in the parts, in applications or current one
+    vector<Program *> programs( applications );
+    if( currentApplication )
+        programs.push_back( currentApplication );
+    for( MetaDataPart &part : parts )
+        for( auto &mark : part.marks )
+            if( mark.second )
+                programs.push_back( mark.second );
+    std::sort( programs.begin(), programs.end() );
+    programs.erase( std::unique( programs.begin(), programs.end() ), programs.end() );
+    for( Program *program : programs )
+        delete program;
+    applications.clear();
+    currentApplication = NULL;
+    osRunning = false;
+    return false;
+}
+
+void * Simulation::MetaDataWorker( void * readPtr )
+{
+    MetaDataRead *read = (MetaDataRead *)readPtr;
+    size_t i;
+    while( (i = read->next++) < read->parts->size() )
+        read->sim->parsePart( (*read->parts)[i] );
+    return NULL;
+}
+
+void Simulation::parsePart( MetaDataPart &part )
+{
+    unsigned long processorMs = settings.processorCycleMs;
+    unsigned long memoryMs = settings.memoryCycleMs;
+    bool inHead = true;
+    Program *program = NULL;
+
+    // Errors only fail the part, meta-data is read again to report them
+    mdParser.ParseChunk( part.begin, part.end, [&]( char code, std::string_view descriptor, long int cycles ) {
+        SimEvent event = checkEvent( code, descriptor, cycles );
+        switch( event.code )
+        {
+            case 'S':
+                part.marks.emplace_back( event, (Program *)NULL );
+                inHead = false;
+                break;
+            case 'A':
+                program = NULL;
+                if( event.descriptor == EventDescriptor::START )
+                {
+                    program = new Program();
+                    program->workTime = 0;
+                }
+                part.marks.emplace_back( event, program );
+                inHead = false;
+                break;
+            default:
+                if( inHead )
+                {
+                    part.head.push_back( event );
+                    part.headWork += eventWork( event, processorMs, memoryMs );
+                }
+                else if( program )
+                {
+                    program->events.push_back( event );
+                    program->workTime += eventWork( event, processorMs, memoryMs );
+                }
+                else
+                    throw SimError( "%c(%s)%u Attempt to execute outside of application.", event.code, DescriptorName( event.descriptor ), event.cycles );
+        }
+    }, part.chunk );
+}
+
+bool Simulation::mergeParts( vector<MetaDataPart> &parts )
+{
+    string carry;           // Event shared by parts, joined from their ends
+    char last = '\0';
+    bool footer = false;
+
+    // Parses event joined from the ends of parts
+    auto addCarried = [this]( std::string_view text ) {
+        char code;
+        std::string_view descriptor;
+        long int cycles;
+        if( !MetaDataParser::ParseEvent( text, code, descriptor, cycles ) )
+            return false;
+        AddEvent( code, descriptor, cycles );
+        return true;
+    };
+
+    for( MetaDataPart &part : parts )
+    {
+        if( part.chunk.failed )
+            return false;
+        if( part.chunk.last )
+            last = part.chunk.last;
+
+        carry += part.chunk.leading;
+        if( part.chunk.separated )
+        {
+            if( !addCarried( carry ) )
+                return false;
+            if( !part.head.empty() )
+            {
+                if( !currentApplication )
+                    return false;
+                currentApplication->events.insert( currentApplication->events.end(), part.head.begin(), part.head.end() );
+                currentApplication->workTime += part.headWork;
+            }
+            for( auto &mark : part.marks )
+            {
+                addEvent( mark.first, mark.second );
+                mark.second = NULL;     // Owned by applications now
+            }
+            carry = part.chunk.trailing;
+        }
+
+        if( part.chunk.footer )
+        {
+            footer = true;
+            break;
+        }
+    }
+    if( !footer || last != '.' )
+        return false;
+
+    // Last event ends with the period
+    carry.pop_back();
+    return addCarried( carry );
+}
+
+void Simulation::AddEvent( char code, std::string_view descriptor, long int cycles )
+{
+    addEvent( checkEvent( code, descriptor, cycles ) );
+}
+
+SimEvent Simulation::checkEvent( char code, std::string_view descriptor, long int cycles ) const
+{
+    // Check if event is valid
+    unsigned int valid = validDescriptors( code );
+    if( !valid )
+        throw SimError( "%c(%.*s)%ld Unknown event code for meta-data event.", code, (int)descriptor.size(), descriptor.data(), cycles );
+
+    size_t index = 0;
+    while( index < (size_t)EventDescriptor::COUNT && descriptor != descriptorNames[index] )
+        ++index;
+    if( index == (size_t)EventDescriptor::COUNT || !(valid & (1u << index)) )
+        throw SimError( "%c(%.*s)%ld Invalid descriptor for meta-data event.", code, (int)descriptor.size(), descriptor.data(), cycles );
+    if( cycles < 0 || cycles > UINT_MAX )
+        throw SimError( "%c(%.*s)%ld Invalid cycles for meta-data event.", code, (int)descriptor.size(), descriptor.data(), cycles );
+    return SimEvent{code, (EventDescriptor)index, (unsigned int)cycles};
+}
+
+void Simulation::addEvent( const SimEvent &event, Program *program )
+{
+    const char *name = DescriptorName( event.descriptor );
+    long int cycles = event.cycles;
 
     // Process the event
-    switch(code)
+    switch(event.code)
     {
         case 'S': 
-            if( event.descriptor == "start" && osRunning )
-                throw SimError( "%c(%s)%ld Attempt to start OS while OS its already running!", event.code, event.descriptor.c_str(), event.cycles );
-            else if( event.descriptor == "end" && !osRunning )
-                throw SimError( "%c(%s)%ld Attempt to stop OS while OS its already stopped!", event.code, event.descriptor.c_str(), event.cycles );
-            osRunning = event.descriptor == "start";
+            if( event.descriptor == EventDescriptor::START && osRunning )
+                throw SimError( "%c(%s)%ld Attempt to start OS while OS its already running!", event.code, name, cycles );
+            else if( event.descriptor == EventDescriptor::END && !osRunning )
+                throw SimError( "%c(%s)%ld Attempt to stop OS while OS its already stopped!", event.code, name, cycles );
+            osRunning = event.descriptor == EventDescriptor::START;
             break;
-        case 'A': validDescriptors = { "start", "end" }; 
+        case 'A':
             if( !osRunning )
-                throw SimError( "%c(%s)%ld Attempt to %s application without OS!", event.code, event.descriptor.c_str(), event.cycles, event.descriptor.c_str() );
-            if( event.descriptor == "start" )
+                throw SimError( "%c(%s)%ld Attempt to %s application without OS!", event.code, name, cycles, name );
+            if( event.descriptor == EventDescriptor::START )
             {
                 if(currentApplication)
-                    throw SimError( "%c(%s)%ld Attempt to start new application within running application!", event.code, event.descriptor.c_str(), event.cycles );
+                    throw SimError( "%c(%s)%ld Attempt to start new application within running application!", event.code, name, cycles );
                 
-                currentApplication = new Application();
+                currentApplication = program;
+                if( !currentApplication )
+                {
+                    currentApplication = new Program();
+                    currentApplication->workTime = 0;
+                }
             }
-            else if( event.descriptor == "end" )
+            else if( event.descriptor == EventDescriptor::END )
             {
                 if(!currentApplication)
-                    throw SimError( "%c(%s)%ld Attempt to stop non-existing application!", event.code, event.descriptor.c_str(), event.cycles );
-                applications.push_back(currentApplication);
+                    throw SimError( "%c(%s)%ld Attempt to stop non-existing application!", event.code, name, cycles );
+                currentApplication->events.shrink_to_fit();
+                currentApplication->eventData = currentApplication->events.data();
+                currentApplication->eventCount = currentApplication->events.size();
+                if( !streamMetaData )
+                    applications.push_back(currentApplication);
+                else if( !streamedPrograms.Push(currentApplication) )
+                {
+                    delete currentApplication;
+                    currentApplication = NULL;
+                    throw SimError( "Meta-data reading was cancelled." );
+                }
                 currentApplication = NULL;
             }
             break;
@@ -398,358 +876,970 @@ void Simulation::AddEvent( char code, string &descriptor, long int cycles )
         case 'O':
         case 'M':
             if( !currentApplication )
-                throw SimError( "%c(%s)%ld Attempt to execute outside of application.", event.code, event.descriptor.c_str(), event.cycles );
-            currentApplication->push_back(event);
+                throw SimError( "%c(%s)%ld Attempt to execute outside of application.", event.code, name, cycles );
+            currentApplication->events.push_back(event);
+            currentApplication->workTime += eventWork( event, settings.processorCycleMs, settings.memoryCycleMs );
             break;
         default:
-            throw SimError( "%c(%s)%ld Unknown event code for meta-data event.", code, descriptor.c_str(), cycles );
+            throw SimError( "%c(%s)%ld Unknown event code for meta-data event.", event.code, name, cycles );
     }
 }
 
 void Simulation::doWork( long int ms )
 {
-    auto t_end = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds( ms );
-    while(std::chrono::high_resolution_clock::now() < t_end);
+    timers.SleepFor( ms );
 }
-long int Simulation::doProcWork( long int ms )
+long int Simulation::doProcWork( SimCore &core, long int ms )
 {
-    auto t_end = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds( ms );
-    while(std::chrono::high_resolution_clock::now() < t_end)
+    if( virtualTime )
     {
-        if(simInterrupt)
-        {
-            long int timeRemaining = std::chrono::duration_cast<std::chrono::milliseconds>(t_end-std::chrono::high_resolution_clock::now()).count();
-            return timeRemaining > 0 ? timeRemaining : 0;
-        }
+        if( ms <= 0 )
+            return 0;
+
+        // Fire events that happen before the work is done, any of them may interrupt
+        unsigned long t_end = timers.Now() + ms;
+        while( !checkInterrupt( core ) && timers.HasEvents() && timers.NextEventTime() < t_end )
+            timers.AdvanceToNext();
+
+        if( core.interrupt )
+            return t_end - timers.Now();
+        timers.AdvanceTo( t_end );
+        return 0;
+    }
+
+    uint64_t t_end = TscClock::NowNs() + (uint64_t)ms * 1000000;
+    uint64_t now;
+    while((now = TscClock::NowNs()) < t_end)
+    {
+        if(checkInterrupt(core))
+            return (t_end - now) / 1000000;
     }
     return 0;
 }
 
-float Simulation::simTime()
+bool Simulation::checkInterrupt( SimCore &core )
+{
+    if( core.tick && core.tick.exchange( false ) && core.running )
+    {
+        if( core.jobs.Tick( core.running, timers.Now() - core.runStart ) )
+            core.interrupt |= SIM_INTERRUPT_SCHEDULER;
+    }
+    return core.interrupt != 0;
+}
+
+uint16_t Simulation::TraceCore() const
+{
+    return runningCore ? traceCore( *runningCore ) : TRACE_NO_CORE;
+}
+
+uint16_t Simulation::traceCore( const SimCore &core ) const
+{
+    return core.label[0] ? (uint16_t)core.id : TRACE_NO_CORE;
+}
+
+uint64_t Simulation::simNow()
 {
-    auto simCurrentTime = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::microseconds>(simCurrentTime - simStartTime).count() / 1e6;
+    if( virtualTime )
+        return (uint64_t)timers.Now() * 1000000;
+    return TscClock::NowNs() - simStartNs;
+}
+
+double Simulation::simTime()
+{
+    return simNow() / 1e9;
 }
 
 void Simulation::simResetTimer()
 {
-    simStartTime = std::chrono::high_resolution_clock::now();
+    simStartNs = TscClock::NowNs();
+    timers.Start( virtualTime );
+}
+
+bool Simulation::VirtualTime() const
+{
+    return virtualTime;
+}
+
+unsigned long Simulation::VirtualNow() const
+{
+    return timers.Now();
+}
+
+TimerHandle Simulation::ScheduleEvent( unsigned long delay, std::function<void()> callback )
+{
+    return timers.Schedule( delay, callback );
 }
 
-void Simulation::handleProc( unsigned int pid, const SimEvent &event )
+void Simulation::handleProc( SimCore &core, PCB *process, const SimEvent &event )
 {
-    PCB *process = processes[pid];
+    unsigned int pid = process->pid;
     long int event_time;
     if(process->eventInProgress){
         event_time = process->eventTimeRemaining;
     }else{
-        event_time = event.cycles * config.GetInt( "Processor cycle time (msec)" );
-        Log( "%lf - Process %d: start processing action\n", simTime(), pid);
+        event_time = event.cycles * settings.processorCycleMs;
+        SIM_LOG( this, PROCESS, DETAIL, trace( TraceEvent::PROC_START, pid, core ) );
     }
     
 
-    long int timeRemaining = doProcWork(event_time);
+    long int timeRemaining = doProcWork(core, event_time);
+    chargeWork(process, event_time - timeRemaining);
 
-    if(simInterrupt){
+    if(core.interrupt){
         process->eventInProgress = true;
         process->eventTimeRemaining = timeRemaining;
 
-        Log( "%lf - Process %d: interrupt processing action\n", simTime() , pid);
+        SIM_LOG( this, PROCESS, DETAIL, trace( TraceEvent::PROC_INTERRUPT, pid, core ) );
     }else{
-        Log( "%lf - Process %d: end processing action\n", simTime(), pid );
+        SIM_LOG( this, PROCESS, DETAIL, trace( TraceEvent::PROC_END, pid, core ) );
         process->eventInProgress = false;
-        process->eventQueue.pop_front();
+        completeEvent(process);
     }
-    process->state = ProcessState::READY;
+    process->State() = ProcessState::READY;
 }
 
-void Simulation::handleMem( unsigned int pid, const SimEvent &event )
+void Simulation::handleMem( SimCore &core, PCB *process, const SimEvent &event )
 {
-    PCB *process = processes[pid];
+    if(virtualMemory){
+        handlePagedMem( core, process, event );
+        return;
+    }
+
+    unsigned int pid = process->pid;
     long int event_time;
 
     if(process->eventInProgress){
         event_time = process->eventTimeRemaining;
     }else{
-        event_time = event.cycles * config.GetInt( "Memory cycle time (msec)" );
+        event_time = event.cycles * settings.memoryCycleMs;
     }
 
     long int timeRemaining;
+    bool failed = false;
 
-    if( event.descriptor == "allocate" )
+    if( event.descriptor == EventDescriptor::ALLOCATE )
     {
         if(!process->eventInProgress)
-            Log( "%lf - Process %d: allocating memory\n", simTime(), pid );
+            SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_ALLOCATING, pid, core ) );
 
-        timeRemaining = doProcWork(event_time);
+        timeRemaining = doProcWork(core, event_time);
 
-        if(!simInterrupt){
-            unsigned int newMemory = allocateMemory( 1 );
-            Log( "%lf - Process %d: memory allocated at 0x%08x\n", simTime(), pid, newMemory );
+        if(!core.interrupt){
+            unsigned int newMemory;
+            if( allocateMemory( pid, 1, newMemory ) )
+                SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_ALLOCATED, pid, core, newMemory ) );
+            else
+            {
+                SIM_LOG( this, MEMORY, INFO, trace( TraceEvent::MEM_OUT, pid, core ) );
+                failed = true;
+            }
         }
     }
-    else if( event.descriptor == "block" )
+    else if( event.descriptor == EventDescriptor::BLOCK )
     {
         if(!process->eventInProgress)
-            Log( "%lf - Process %d: start memory blocking\n", simTime(), pid );
+            SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_BLOCK_START, pid, core ) );
 
-        timeRemaining = doProcWork(event_time);
+        timeRemaining = doProcWork(core, event_time);
 
-        if(!simInterrupt)
-            Log( "%lf - Process %d: end memory blocking\n", simTime(), pid );
+        if(!core.interrupt)
+            SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_BLOCK_END, pid, core ) );
     }
 
+    chargeWork(process, event_time - timeRemaining);
 
-    if(simInterrupt){
-        Log( "%lf - Process %d: interrupt processing action\n", simTime() , pid);
+    if(core.interrupt){
+        SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::PROC_INTERRUPT, pid, core ) );
         process->eventInProgress = true;
         process->eventTimeRemaining = timeRemaining;
+    }else if(failed){
+        process->eventInProgress = false;
+        process->State() = ProcessState::EXIT;
+        return;
     }else{
         process->eventInProgress = false;
-        process->eventQueue.pop_front();
+        completeEvent(process);
     }
-    process->state = ProcessState::READY;
+    process->State() = ProcessState::READY;
 }
 
-void Simulation::handleIO( unsigned int pid, const SimEvent &event )
+void Simulation::handlePagedMem( SimCore &core, PCB *process, const SimEvent &event )
 {
-    PCB *process = processes[pid];
+    unsigned int pid = process->pid;
+    long int cycleTime = settings.memoryCycleMs;
+    bool allocate = event.descriptor == EventDescriptor::ALLOCATE;
+
+    if(!process->eventInProgress){
+        process->eventInProgress = true;
+        process->eventTimeRemaining = event.cycles * cycleTime;
+        process->memAccesses = 0;
+        if(allocate){
+            SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_ALLOCATING, pid, core ) );
+            pthread_mutex_lock(&memMutex);
+            vm.Allocate(pid);
+            pthread_mutex_unlock(&memMutex);
+        }else{
+            SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_BLOCK_START, pid, core ) );
+        }
+    }
+
+    while(true)
+    {
+        // Page faulted earlier but hard drive wasn't taken yet
+        if(process->pageIn == PageInState::PENDING)
+        {
+            if(requestPageIn(core, process))
+                return;
+            break;
+        }
+
+        // Run cycles whose pages are touched
+        long int pending = process->eventTimeRemaining - (long int)(event.cycles - process->memAccesses) * cycleTime;
+        if(pending > 0)
+        {
+            long int left = doProcWork(core, pending);
+            chargeWork(process, pending - left);
+            process->eventTimeRemaining -= pending - left;
+            if(core.interrupt)
+                break;
+        }
+
+        pthread_mutex_lock(&memMutex);
+        unsigned long pages = vm.Pages(pid);
+        if(process->memAccesses == event.cycles)
+        {
+            pthread_mutex_unlock(&memMutex);
+            if(allocate)
+                SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_ALLOCATED, pid, core,
+                    (pages - 1) * settings.memoryBlockKb ) );
+            else
+                SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::MEM_BLOCK_END, pid, core ) );
+            process->eventInProgress = false;
+            completeEvent(process);
+            process->State() = ProcessState::READY;
+            return;
+        }
+
+        // Touch page of the next cycle
+        unsigned long page = allocate ? pages - 1 : vm.NextPage(pid);
+        PageFault fault;
+        PageAccess access = vm.Access(core.id, pid, page, fault);
+        pthread_mutex_unlock(&memMutex);
+        ++process->memAccesses;
+
+        if(access == PageAccess::FAULT)
+        {
+            SIM_LOG( this, MEMORY, DETAIL, tracePageFault( core, pid, page, fault ) );
+            process->pageIn = PageInState::PENDING;
+        }
+    }
+
+    SIM_LOG( this, MEMORY, DETAIL, trace( TraceEvent::PROC_INTERRUPT, pid, core ) );
+    process->State() = ProcessState::READY;
+}
+
+bool Simulation::requestPageIn( SimCore &core, PCB *process )
+{
+    // Process waits from the moment request is queued, device can finish any time after
+    process->State() = ProcessState::WAITING;
+    process->pageIn = PageInState::WAITING;
+    process->faultTime = timers.Now();
+
+    bool resource_retrieved = false;
+    while(!resource_retrieved && !core.interrupt)
+        resource_retrieved = resHdd->run( 1, INPUT, process->pid );
+
+    if(!resource_retrieved){
+        process->pageIn = PageInState::PENDING;
+        process->State() = ProcessState::READY;
+    }
+    return resource_retrieved;
+}
+
+void Simulation::handleIO( SimCore &core, PCB *process, const SimEvent &event )
+{
+    unsigned int pid = process->pid;
     if(process->eventInProgress){
         process->eventInProgress = false;
-        process->eventQueue.pop_front();
-        process->state = ProcessState::READY;
+        completeEvent(process);
+        process->State() = ProcessState::READY;
     }else{
-        ResourceIO *resource = NULL; 
-
-        if( event.descriptor == "hard drive" )
-            resource = resHdd;
-        else if( event.descriptor == "monitor" )
-            resource = resMonitor;
-        else if( event.descriptor == "printer" )
-            resource = resPrinter;
-        else if( event.descriptor == "keyboard" )
-            resource = resKeyboard;
-        else if( event.descriptor == "mouse" )
-            resource = resMouse;
-        else if( event.descriptor == "speaker" )
-            resource = resSpeaker;
+        ResourceIO *resource = ioResources[(size_t)event.descriptor];
+
+        // Process waits from the moment request is queued, device can finish any time after
+        process->eventInProgress = true;
+        process->State() = ProcessState::WAITING; 
 
         bool resource_retrieved = false;
         ResIOState resource_io = event.code == 'I' ? INPUT : OUTPUT;
-        while(!resource_retrieved && !simInterrupt)
+        while(!resource_retrieved && !core.interrupt)
             resource_retrieved = resource->run( event.cycles, resource_io, pid );
 
-        if(resource_retrieved){
-            process->eventInProgress = true;
-            process->state = ProcessState::WAITING; 
+        if(!resource_retrieved){
+            process->eventInProgress = false;
+            process->State() = ProcessState::READY; 
         }
     }
 }
 
-unsigned long Simulation::GetRemainingTime( unsigned int pid )
+unsigned long Simulation::computeRemainingTime( const Program *program ) const
 {
-    unsigned long remaining_time = 0;
-    PCB * process = processes[pid];
-    for(auto it = process->eventQueue.begin(); it != process->eventQueue.end(); ++it) {
-        // I wasn't sure how its bein calculated, so made 2 version. 
+    // Acts as SJF from project 4, 1 task is 1 time unit 
+    if(remainingTimeMode == RemainingTimeMode::EVENTS)
+        return program->eventCount;
+    return program->workTime;
+}
 
-        ////////////////////////////////////////////////////////////////////////
-        // Version 1 : Acts as SJF from project 4, 1 task is 1 time unit 
-        
-        ++remaining_time;
-
-        ////////////////////////////////////////////////////////////////////////
-        // Version 2 : Computes remaining time in ms of P and M tasks, doesn't
-        //             include IO cause that doesn't effect processing time.
-        /*
-        if(it == process->eventQueue.begin() && process->eventInProgress){
-            remaining_time += process->eventTimeRemaining;
-        }else{
-            switch(event.code)
+void Simulation::chargeWork( PCB *process, long int ms )
+{
+    if(remainingTimeMode != RemainingTimeMode::TIME || ms <= 0)
+        return;
+    process->RemainingTime() -= std::min<unsigned long>(ms, process->RemainingTime());
+}
+
+void Simulation::completeEvent( PCB *process )
+{
+    ++process->pc;
+    if(remainingTimeMode == RemainingTimeMode::EVENTS && process->RemainingTime() > 0)
+        --process->RemainingTime();
+}
+
+bool Simulation::LoadApplications( )
+{
+    if( streamMetaData )
+        return streamApplications();
+
+    raiseInterrupt(SIM_INTERRUPT_LOADER);
+    pthread_mutex_lock(&simMutex);
+    for(auto it = applications.begin(); it != applications.end(); ++it)
+        admitProcess(*it);
+    pthread_mutex_unlock(&simMutex);
+    return true;
+}
+
+bool Simulation::streamApplications( )
+{
+    // Later rounds run the programs read in the first one, none if it hit an error
+    if( streamRead )
+    {
+        if( mdError )
+            return true;
+        raiseInterrupt(SIM_INTERRUPT_LOADER);
+        pthread_mutex_lock(&simMutex);
+        for( Program *program : applications )
+            admitProcess( program );
+        pthread_mutex_unlock(&simMutex);
+        return true;
+    }
+
+    // Batch is what the reader may get ahead, so waiting for it never waits for the rest of the file
+    Program *program;
+    for( unsigned int i = 0; i < settings.mdQueueDepth; ++i )
+    {
+        // Meta-data ended, or reading failed or was cancelled
+        if( !streamedPrograms.Pop( program ) )
+        {
+            streamRead = true;
+            return true;
+        }
+
+        if( i == 0 )
+            raiseInterrupt(SIM_INTERRUPT_LOADER);
+        pthread_mutex_lock(&simMutex);
+        program->refs = 1;      // Loader keeps it until the last round
+        applications.push_back( program );
+        admitProcess( program );
+        pthread_mutex_unlock(&simMutex);
+    }
+    return false;
+}
+
+void Simulation::releaseProgram( const Program *program )
+{
+    pthread_mutex_lock(&simMutex);
+    bool last = --program->refs == 0;
+    pthread_mutex_unlock(&simMutex);
+    if( last )
+        delete program;
+}
+
+void Simulation::admitProcess( Program *program )
+{
+    PCB * newProcess = processes.Allocate();
+
+    SIM_LOG( this, OS, INFO, Trace( TraceEvent::PREPARE, newProcess->pid ) );
+    
+    newProcess->State() = ProcessState::START;
+    newProcess->program = program;
+    if(streamMetaData)
+        ++program->refs;
+    newProcess->pc = 0;
+    newProcess->eventInProgress = false;
+    newProcess->eventTimeRemaining = 0;
+    newProcess->memAccesses = 0;
+    newProcess->pageIn = PageInState::NONE;
+    newProcess->RemainingTime() = computeRemainingTime(newProcess->program);
+    newProcess->lastCore = nextCore++ % cores.size();
+    newProcess->cpuTime = 0;
+    newProcess->Priority() = 0;
+    newProcess->sched = SchedEntity{0, 0};
+    newProcess->parked = false;
+    ++liveProcesses;
+
+    queueJob(newProcess);
+}
+
+void Simulation::queueJob( PCB *process, bool woken )
+{
+    SimCore *core = cores[pickCore(process)];
+    core->jobs.Push(process, woken);
+
+    // Chosen core is busy, let an idle one steal the job
+    if(cores.size() > 1 && !core->idle)
+    {
+        for(SimCore *other : cores)
+        {
+            if(other->idle)
             {
-                case 'P': remaining_time += event.cycles * config.GetInt( "Processor cycle time (msec)" ); break;
-                case 'M': remaining_time += event.cycles * config.GetInt( "Memory cycle time (msec)" ); break;
+                other->jobs.Notify();
+                break;
             }
         }
-        */
     }
+}
+
+unsigned int Simulation::pickCore( PCB *process )
+{
+    unsigned int last = process->lastCore;
+    if(cores.size() == 1 || cores[last]->idle)
+        return last;
+    for(SimCore *core : cores)
+        if(core->idle)
+            return core->id;
+    return last;
+}
 
-    return remaining_time;
+bool Simulation::takeJob( SimCore &core, PCB *&process )
+{
+    if(core.jobs.Pop(process))
+        return true;
+
+    // Own queue is empty, steal from the next busy core
+    for(size_t i = 1; i < cores.size(); ++i)
+    {
+        SimCore *victim = cores[(core.id + i) % cores.size()];
+        if(victim->jobs.Pop(process))
+        {
+            ++core.steals;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Simulation::raiseInterrupt( unsigned short flag )
+{
+    for(SimCore *core : cores)
+        core->interrupt |= flag;
+}
+
+void Simulation::notifyCores( )
+{
+    for(SimCore *core : cores)
+        core->jobs.Notify();
+}
+
+void Simulation::WakeProcess( unsigned int pid )
+{
+    PCB *process = processes.Get(pid);
+
+    // Page is in, charge the wait up to now and not the ready-queue wait after it
+    if(process->pageIn == PageInState::WAITING){
+        pthread_mutex_lock(&memMutex);
+        vm.ChargePaging(pid, timers.Now() - process->faultTime);
+        pthread_mutex_unlock(&memMutex);
+        process->pageIn = PageInState::NONE;
+    }
+
+    // Stamp before the state CAS, dispatcher may requeue it as soon as it sees READY
+    process->wakeTime.store(TscClock::NowNs(), std::memory_order_relaxed);
+    ProcessState waiting = ProcessState::WAITING;
+    if(process->State().compare_exchange_strong(waiting, ProcessState::READY)){
+        // Whoever of us and the dispatcher takes the parked flag requeues it
+        if(process->parked.exchange(false))
+            queueJob(process, true);
+    }
+}
+
+void Simulation::finishLoading( )
+{
+    if(streamMetaData)
+    {
+        vector<Program *> programs;
+        pthread_mutex_lock(&simMutex);
+        programs.swap( applications );
+        pthread_mutex_unlock(&simMutex);
+        for( Program *program : programs )
+            releaseProgram( program );
+    }
+    loaderFinished = true;
+    notifyCores();
 }
 
 void * Simulation::JobLoader( void * simPtr )
 {
     Simulation *sim = (Simulation *)simPtr;
-    std::vector<Application *> *applications = &(sim->applications);
-    for( size_t i = 0; i<10; ++i ){
+    for( size_t i = 0; i<LOADER_ROUNDS; ++i ){
         if( i != 0 ) // Wait 100ms
             sim->doWork(100);
         
-        sim->simInterrupt |= SIM_INTERRUPT_LOADER;
-        pthread_mutex_lock(&(sim->simMutex));
-
-        // Load applications
-        for(auto it = applications->begin(); it != applications->end(); ++it) {
-            unsigned int newPid = sim->processCounter++;
-
-            sim->Log( "%lf - OS: preparing process %u\n", sim->simTime(), newPid );
-            
-            PCB * newProcess = new PCB();
-            newProcess->state = ProcessState::START;
-            newProcess->pid = newPid;
-            newProcess->eventQueue = **it;
-            newProcess->eventInProgress = false;
-            newProcess->eventTimeRemaining = 0;
-            
-            if( newPid >= sim->processes.size() ){
-                sim->processes.resize(sim->processes.size()*2);
-            }
-            sim->processes[newPid] = newProcess;
-            
-            int process_priority = 0;
-            if(sim->scheduling == SchedulingCode::SRTF)
-                process_priority = sim->GetRemainingTime(newPid);
-
-            sim->jobs.push(Job{newPid, process_priority});
-        }
-
-        sim->simInterrupt &= ~SIM_INTERRUPT_LOADER;
-        pthread_mutex_unlock(&(sim->simMutex));
+        while( !sim->LoadApplications() );
     }
 
-    sim->loaderFinished = true;
+    sim->finishLoading();
     return NULL;
 }
 
-void * Simulation::SchedulerRR( void * simPtr )
+void * Simulation::MetaDataReader( void * simPtr )
 {
     Simulation *sim = (Simulation *)simPtr;
-    while(true){
-        sim->doWork(50);
-        sim->simInterrupt |= SIM_INTERRUPT_SCHEDULER_RR;
+    try
+    {
+        // Read once, loader keeps the programs for its later rounds
+        sim->parseMetaData();
     }
+    catch( ... )
+    {
+        sim->mdError = std::current_exception();
+    }
+    sim->mdParser.Close();
+    sim->streamedPrograms.Close();
+    return NULL;
+}
 
+void * Simulation::CoreDispatcher( void * corePtr )
+{
+    SimCore *core = (SimCore *)corePtr;
+    runningCore = core;
+    while(core->sim->DispatchNextJob(*core));
+    runningCore = NULL;
     return NULL;
 }
 
 void Simulation::Run()
 {
     Simulation::simResetTimer();
-    Log( "%lf - Simulator program starting\n", simTime() );
+    SIM_LOG( this, OS, SUMMARY, Trace( TraceEvent::SIM_START, 0 ) );
 
     // Prepare the simulation for execution
-    processCounter = 0;
+    processes.Clear();
+    memory.Reset( maxMemoryBlocks, timers.Now() );
+    vm.Reset( maxMemoryBlocks, cores.size(), settings.tlbEntries, pageReplacement );
     loaderFinished = false;
-    simInterrupt = 0;
+    liveProcesses = 0;
+    nextCore = 0;
+    for( SimCore *core : cores )
+    {
+        core->jobs.Clear();
+        core->interrupt = 0;
+        core->tick = false;
+        core->idle = false;
+        core->running = NULL;
+        core->dispatches = 0;
+        core->steals = 0;
+        core->dispatchWakeups = 0;
+        core->dispatchLatencyTotal = 0;
+        core->dispatchLatencyMax = 0;
+    }
+
+    ResourceIO *resources[] = { resHdd, resPrinter, resMonitor, resKeyboard, resMouse, resSpeaker };
+    for( ResourceIO *resource : resources )
+        resource->Start();
+
+    // Scheduler tick is periodic, every tick arms the next one
+    unsigned long tickPeriod = cores[0]->jobs.Policy().TickPeriod();
+    if(tickPeriod)
+    {
+        schedulerTick = [this, tickPeriod]{
+            for(SimCore *core : cores)
+                core->tick = true;
+            timers.Schedule( tickPeriod, schedulerTick );
+        };
+        timers.Schedule( tickPeriod, schedulerTick );
+    }
+
+    // So is priority boost, every core's policy gets the same epoch
+    unsigned long boostPeriod = cores[0]->jobs.Policy().BoostPeriod();
+    boostEpoch = 0;
+    if(boostPeriod)
+    {
+        schedulerBoost = [this, boostPeriod]{
+            ++boostEpoch;
+            for(SimCore *core : cores)
+                core->jobs.Boost( boostEpoch );
+            timers.Schedule( boostPeriod, schedulerBoost );
+        };
+        timers.Schedule( boostPeriod, schedulerBoost );
+    }
+
+    // Streamed meta-data is read while the first programs already run
+    if(streamMetaData && !mdReaderRunning)
+    {
+        streamedPrograms.Reset( settings.mdQueueDepth );
+        streamRead = false;
+        int rc = pthread_create(&mdReader, NULL, Simulation::MetaDataReader, this);
+        if( rc ) throw SimError( "Unable to create meta-data reader thread, error code (%d).", rc );
+        mdReaderRunning = true;
+    }
 
-    pthread_t schedulerThread;
     pthread_t loaderThread;
-    int rc;
-    rc = pthread_create(&loaderThread, NULL, Simulation::JobLoader, this);
-    if( rc ) throw SimError( "Unable to create loader thread, error code (%d).", rc );
+    if(virtualTime)
+    {
+        // Loader arrivals are timer events, first one right away
+        loaderRound = 0;
+        loaderRoundStart = 0;
+        loaderArrival = [this]{
+            // Rest of a streamed round comes in later batches, processes run meanwhile
+            if(!LoadApplications())
+            {
+                timers.Schedule( STREAM_BATCH_MS, loaderArrival );
+                return;
+            }
+            if(++loaderRound == LOADER_ROUNDS)
+            {
+                finishLoading();
+                return;
+            }
 
-    // Initiate round robin thread, if scheduling is set
-    if(scheduling == SchedulingCode::RR)
+            // Next round 100 ms after this one started, or now if reading it took longer
+            unsigned long now = timers.Now();
+            loaderRoundStart = std::max( loaderRoundStart + 100, now );
+            timers.Schedule( loaderRoundStart - now, loaderArrival );
+        };
+        timers.Schedule( 0, loaderArrival );
+    }
+    else
     {
-        int rc = pthread_create(&schedulerThread, NULL, Simulation::SchedulerRR, this);
+        int rc = pthread_create(&loaderThread, NULL, Simulation::JobLoader, this);
         if( rc ) throw SimError( "Unable to create loader thread, error code (%d).", rc );
-    }    
+    }
 
+    // Execute the simulation, first core is dispatched by this thread
+    for( size_t i = 1; i < cores.size(); ++i )
+    {
+        int rc = pthread_create(&cores[i]->thread, NULL, Simulation::CoreDispatcher, cores[i]);
+        if( rc ) throw SimError( "Unable to create dispatcher thread, error code (%d).", rc );
+    }
 
-    // Execute the simulation
-    while(!loaderFinished || !jobs.empty())
+    runningCore = cores[0];
+    while(DispatchNextJob(*cores[0]));
+    runningCore = NULL;
+
+    for( size_t i = 1; i < cores.size(); ++i )
+        pthread_join(cores[i]->thread, NULL);
+    if(!virtualTime)
+        pthread_join(loaderThread, NULL);
+    if(mdReaderRunning)
     {
-        pthread_mutex_lock(&simMutex);
-        while(!jobs.empty() && !(simInterrupt & SIM_INTERRUPT_LOADER))
-        {   
-            // Pop next process from scheduling queue
-            Job job = jobs.top();
-            jobs.pop();
-
-            unsigned int pid = job.pid;
-            PCB *process = processes[pid];
-            currentProcess = pid;
-            ProcessState state = process->state;
-
-            // If the process is newly created, set it to ready
-            if(state == ProcessState::START)
-                process->state = ProcessState::READY;
-
-            // Start of process execution
-            if(state == ProcessState::READY)
-                RunProcess(pid);
-            state = process->state;
-            // End of process execution
-
-            // Clear RR flag, since process is already been interrupted
-            simInterrupt &= !SIM_INTERRUPT_SCHEDULER_RR;
-
-
-            // Readd the process into scheduling queue
-            if(state != ProcessState::EXIT){
-                int process_priority = 0;
-                if(scheduling == SchedulingCode::SRTF)
-                    process_priority = -GetRemainingTime(pid);
-                jobs.push(Job{pid, process_priority});
-            }
+        pthread_join(mdReader, NULL);
+        mdReaderRunning = false;
+    }
+
+    // Every process completed, so device queues are empty by now
+    for( ResourceIO *resource : resources )
+        resource->Shutdown();
+    timers.Stop();
+
+    // Processes of streamed meta-data read before its error ran anyway
+    if(mdError)
+        std::rethrow_exception(mdError);
+
+    unsigned long dispatchWakeups = 0;
+    double dispatchLatencyTotal = 0;
+    double dispatchLatencyMax = 0;
+    ReadyQueueStats queueStats = {};
+    SchedulerStats schedStats = {};
+    const Scheduler &policy = cores[0]->jobs.Policy();
+    vector<QueueStats> levelStats( policy.QueueCount(), QueueStats() );
+    for( SimCore *core : cores )
+    {
+        dispatchWakeups += core->dispatchWakeups;
+        dispatchLatencyTotal += core->dispatchLatencyTotal;
+        dispatchLatencyMax = std::max( dispatchLatencyMax, core->dispatchLatencyMax );
+
+        ReadyQueueStats coreStats = core->jobs.Stats();
+        queueStats.pushes += coreStats.pushes;
+        queueStats.casRetries += coreStats.casRetries;
+        queueStats.stallNs += coreStats.stallNs;
+        queueStats.maxStallNs = std::max( queueStats.maxStallNs, coreStats.maxStallNs );
+        queueStats.wakeups += coreStats.wakeups;
+        schedStats.Merge( core->jobs.Policy().Stats() );
+        for( size_t i = 0; i < levelStats.size(); ++i )
+            levelStats[i].Merge( core->jobs.Policy().Queue( i ) );
+
+        if( cores.size() > 1 )
+            SIM_LOG( this, SCHEDULER, SUMMARY, Log( "%lf - OS: CPU %u dispatched %lu jobs, %lu of them stolen from other CPUs\n",
+                simTime(), core->id, core->dispatches, core->steals ) );
+    }
+
+    SIM_LOG( this, OS, SUMMARY, Log( "%lf - OS: process table peaked at %u PCBs in %zu chunks, %lu PIDs reused\n",
+        simTime(),
+        processes.Peak(),
+        processes.Chunks(),
+        processes.Reused() ) );
+
+    if( virtualMemory )
+    {
+        const PagingStats &paging = vm.Totals();
+        SIM_LOG( this, MEMORY, SUMMARY, Log( "%lf - OS: virtual memory with %s replacement over %lu frames, %lu accesses, TLB hit rate %.1lf%%, %lu page faults (%.1lf%% of accesses), %lu evictions, %lu ms lost to paging\n",
+            simTime(),
+            vm.Policy().Name(),
+            vm.Frames(),
+            paging.accesses,
+            paging.accesses ? 100.0 * paging.tlbHits / paging.accesses : 0.0,
+            paging.faults,
+            paging.accesses ? 100.0 * paging.faults / paging.accesses : 0.0,
+            paging.evictions,
+            paging.pagingMs ) );
+    }
+    else
+    {
+        MemoryStats memStats = memory.Stats( timers.Now() );
+        SIM_LOG( this, MEMORY, SUMMARY, Log( "%lf - OS: memory %lu allocations, %lu failed, peak %lu of %lu blocks used, avg utilization %.1lf%%\n",
+            simTime(),
+            memStats.allocations,
+            memStats.failures,
+            memStats.peakBlocks,
+            memStats.totalBlocks,
+            memStats.avgUtilization * 100 ) );
+        SIM_LOG( this, MEMORY, SUMMARY, Log( "%lf - OS: memory fragmentation %.1lf%%, max %.1lf%%, largest free extent %lu blocks of %lu free extents\n",
+            simTime(),
+            memStats.fragmentation * 100,
+            memStats.maxFragmentation * 100,
+            memStats.largestFree,
+            memStats.freeExtents ) );
+    }
+
+    SIM_LOG( this, SCHEDULER, SUMMARY, Log( "%lf - OS: dispatch latency after IO completion avg %.3lf us, max %.3lf us over %lu wakeups\n",
+        simTime(),
+        dispatchWakeups ? dispatchLatencyTotal / dispatchWakeups : 0.0,
+        dispatchLatencyMax,
+        dispatchWakeups ) );
+
+    SIM_LOG( this, SCHEDULER, SUMMARY, Log( "%lf - OS: ready queue producers stalled avg %.3lf us, max %.3lf us over %lu pushes (%lu CAS retries, %lu dispatcher wakeups)\n",
+        simTime(),
+        queueStats.pushes ? queueStats.stallNs / 1e3 / queueStats.pushes : 0.0,
+        queueStats.maxStallNs / 1e3,
+        queueStats.pushes,
+        queueStats.casRetries,
+        queueStats.wakeups ) );
+    SIM_LOG( this, SCHEDULER, SUMMARY, Log( "%lf - OS: %s scheduler made %lu decisions, avg %.0lf ns, p50 under %llu ns, p99 under %llu ns, max %llu ns\n",
+        simTime(),
+        policy.Name(),
+        schedStats.decisions,
+        schedStats.decisions ? (double)schedStats.totalNs / schedStats.decisions : 0.0,
+        schedStats.Percentile( 50 ),
+        schedStats.Percentile( 99 ),
+        schedStats.maxNs ) );
+    for( size_t i = 0; i < levelStats.size(); ++i )
+    {
+        const QueueStats &level = levelStats[i];
+        char quantum[32] = "no quantum";
+        if( policy.QueueQuantum( i ) )
+            snprintf( quantum, sizeof quantum, "quantum %lu ms", policy.QueueQuantum( i ) );
+        SIM_LOG( this, SCHEDULER, SUMMARY, Log( "%lf - OS: %s queue %zu (%s) %lu dispatches, residence avg %.1lf ms max %lu ms, response avg %.1lf ms max %lu ms over %lu arrivals and wakeups\n",
+            simTime(),
+            policy.Name(),
+            i,
+            quantum,
+            level.dispatches,
+            level.dispatches ? (double)level.residenceTotal / level.dispatches : 0.0,
+            level.residenceMax,
+            level.responses ? (double)level.responseTotal / level.responses : 0.0,
+            level.responseMax,
+            level.responses ) );
+    }
+    logger.Flush();
+    LogStats logStats = logger.Stats();
+    SIM_LOG( this, OS, SUMMARY, Log( "%lf - OS: logger wrote %lu records in %lu batches, %lu dropped, %lu waited for room\n",
+        simTime(),
+        logStats.records,
+        logStats.batches,
+        logStats.dropped,
+        logStats.blocked ) );
+    SIM_LOG( this, OS, SUMMARY, Trace( TraceEvent::SIM_END, 0 ) );
+
+    // Everything logged is in outputs before Run returns
+    logger.Flush();
+}
+
+bool Simulation::DispatchNextJob( SimCore &core )
+{
+    // Sleep until there is something to run, or everything is done
+    PCB *process;
+    while(!takeJob(core, process))
+    {
+        if(loaderFinished && liveProcesses == 0)
+            return false;
+
+        if(virtualTime)
+        {
+            // Nothing runnable, skip idle time to the next event
+            if(!timers.AdvanceToNext())
+                throw SimError( "Virtual clock ran out of events with %u processes waiting.", liveProcesses.load() );
+            continue;
         }
-        pthread_mutex_unlock(&simMutex);
-        while(simInterrupt & SIM_INTERRUPT_LOADER);
+
+        // Go idle before looking again, so whoever queues a job next
+        // either sees this core idle or the job is found here
+        core.idle = true;
+        bool found = takeJob(core, process);
+        if(!found && !(loaderFinished && liveProcesses == 0))
+            core.jobs.Wait();
+        core.idle = false;
+        if(found)
+            break;
+    }
+    ++core.dispatches;
+    core.currentProcess = process->pid;
+    process->lastCore = core.id;
+    if(process->intakeWoken)
+    {
+        double latency = (TscClock::NowNs() - process->wakeTime.load(std::memory_order_relaxed)) / 1e3;
+        ++core.dispatchWakeups;
+        core.dispatchLatencyTotal += latency;
+        core.dispatchLatencyMax = std::max( core.dispatchLatencyMax, latency );
+    }
+
+    // Interrupts raised while no process was running don't apply to this one
+    core.interrupt = 0;
+    core.tick = false;
+
+    // If the process is newly created, set it to ready
+    if(process->State() == ProcessState::START)
+        process->State() = ProcessState::READY;
+
+    core.running = process;
+    core.runStart = timers.Now();
+
+    // Policy gets ticked when process used up its own quantum
+    unsigned long quantum = core.jobs.Quantum(process);
+    if(quantum)
+    {
+        SimCore *quantumCore = &core;
+        core.quantumTimer = timers.Schedule( quantum, [quantumCore]{ quantumCore->tick = true; } );
     }
-    pthread_join(loaderThread, NULL);
-    Log( "%lf - Simulator program ending\n", simTime() );
+
+    RunProcess(core, process);
+
+    if(quantum)
+        timers.Cancel( core.quantumTimer );
+    core.running = NULL;
+    process->cpuTime += timers.Now() - core.runStart;
+
+    // Readd the process into scheduling queue, or park it until its IO is done
+    ProcessState state = process->State();
+    if(state == ProcessState::EXIT)
+    {
+        if(streamMetaData)
+            releaseProgram( process->program );
+        processes.Release(process);
+        if(--liveProcesses == 0 && loaderFinished)
+            notifyCores();
+    }
+    else if(state != ProcessState::WAITING)
+        queueJob(process);
+    else
+    {
+        core.jobs.Block(process);
+        process->parked = true;
+        if(process->State() != ProcessState::WAITING && process->parked.exchange(false))
+            queueJob(process, true); // IO finished before the process got parked
+    }
+
+    return true;
 }
 
-void Simulation::RunProcess( unsigned int pid )
+void Simulation::RunProcess( SimCore &core, PCB *process )
 {
-    Log( "%lf - OS: starting process %d\n", simTime(), pid );
+    unsigned int pid = process->pid;
+    SIM_LOG( this, SCHEDULER, DETAIL, trace( TraceEvent::START_PROCESS, pid, core ) );
 
-    PCB *process = processes[pid];
-    process->state = ProcessState::RUNNING;
-    while (!process->eventQueue.empty())
+    process->State() = ProcessState::RUNNING;
+    const SimEvent *events = process->program->eventData;
+    size_t eventCount = process->program->eventCount;
+    while (process->pc < eventCount)
     {
-        SimEvent event = process->eventQueue.front();
+        const SimEvent &event = events[process->pc];
         
         switch(event.code)
         {
             case 'P':
-                handleProc( pid, event );
+                handleProc( core, process, event );
                 break;
             case 'M':
-                handleMem( pid, event );
+                handleMem( core, process, event );
                 break;
             case 'I':
             case 'O':
-                handleIO( pid, event );
+                handleIO( core, process, event );
                 break;
             default:
                 continue;
         }
-        if(simInterrupt || process->state == ProcessState::WAITING)
+        if(core.interrupt || process->State() == ProcessState::WAITING || process->State() == ProcessState::EXIT)
             break;
     }
     
-    if(process->eventQueue.empty()){
+    if(process->pc == eventCount){
         // Remove Process
-        Log( "%lf - Process %d completed\n", 
-            simTime(), 
-            pid );
-        processes[pid]->state = ProcessState::EXIT;
+        SIM_LOG( this, PROCESS, INFO, trace( TraceEvent::COMPLETED, pid, core ) );
+        process->State() = ProcessState::EXIT;
     }
+    if(process->State() == ProcessState::EXIT)
+        freeMemory(core, pid);
 }
 
-unsigned int Simulation::allocateMemory( int totMem )
+bool Simulation::allocateMemory( unsigned int pid, int totMem, unsigned int &address )
 {
-    unsigned int blockSize = config.GetInt( "Memory block size (kbytes)" );
+    unsigned int blockSize = settings.memoryBlockKb;
     unsigned int requiredBlocks = (totMem) / blockSize;
     if( blockSize * requiredBlocks < (unsigned int)totMem)
         ++requiredBlocks;
 
-    if( memoryBlockCounter + requiredBlocks >= maxMemoryBlocks)
-        memoryBlockCounter = 0;
+    unsigned long block;
+    pthread_mutex_lock(&memMutex);
+    bool allocated = memory.Allocate( pid, requiredBlocks, timers.Now(), block );
+    pthread_mutex_unlock(&memMutex);
+
+    address = block * blockSize;
+    return allocated;
+}
 
-    unsigned int address = memoryBlockCounter * blockSize;
-    memoryBlockCounter += requiredBlocks;
+void Simulation::freeMemory( SimCore &core, unsigned int pid )
+{
+    if(!virtualMemory){
+        pthread_mutex_lock(&memMutex);
+        memory.FreeAll( pid, timers.Now() );
+        pthread_mutex_unlock(&memMutex);
+        return;
+    }
 
-    return address;
+    pthread_mutex_lock(&memMutex);
+    PagingStats stats = vm.ProcessStats( pid );
+    vm.Release( pid );
+    pthread_mutex_unlock(&memMutex);
+
+    if(!stats.accesses)
+        return;
+    SIM_LOG( this, MEMORY, INFO, Log( "%lf - Process %d: %lu memory accesses, TLB hit rate %.1lf%%, %lu page faults (%.1lf%% of accesses), %lu pages evicted, %lu ms lost to paging%s\n",
+        simTime(),
+        pid,
+        stats.accesses,
+        stats.accesses ? 100.0 * stats.tlbHits / stats.accesses : 0.0,
+        stats.faults,
+        stats.accesses ? 100.0 * stats.faults / stats.accesses : 0.0,
+        stats.evictions,
+        stats.pagingMs,
+        core.label ) );
 }
@@ -1,116 +1,86 @@
 #ifndef _SIMULATION
 #define _SIMULATION
 
+#include "SimError.h"
+#include "Program.h"
 #include "ConfigManager.h"
+#include "SimConfig.h"
 #include "ResourceIO.h"
+#include "TimerService.h"
+#include "ReadyQueue.h"
+#include "ProcessTable.h"
+#include "MemoryManager.h"
+#include "VirtualMemory.h"
+#include "AsyncLogger.h"
+#include "Trace.h"
+#include "LogFilter.h"
+#include "TscClock.h"
+#include "MetaDataParser.h"
+#include "ProgramQueue.h"
+#include "MetaDataCache.h"
 
 #include <string>
+#include <string_view>
 #include <queue>
 #include <deque>
+#include <vector>
 #include <exception>
 #include <cstdarg>
 #include <fstream>
-#include <chrono>
+#include <functional>
 
 #include <pthread.h>
 #include <atomic>
 
 #define SIM_INTERRUPT_LOADER 0b00000001
-#define SIM_INTERRUPT_SCHEDULER_RR 0b00000010
+#define SIM_INTERRUPT_SCHEDULER 0b00000010
 
 
 /**
- * @brief An exception class used by Simulation class.
- * @details Unlike exception provided by standard library,
- *          this exception class allows for the message to
- *          be formated using printf style.
+ * @brief How SRTF measures remaining work of a process.
  * 
- * @param format,... Structure of log output followed by arguments specified in structure.
- * 
- * @return Exception class
  */
-class SimError : std::exception
-{
-    char msg[1024];
-    
-    public:
-        /**
-         * @brief Constructor for SimError exception class.
-         * @details Takes format and varargs to construct a message string.
-         * 
-         * @param format,... Structure of log output followed by arguments specified in structure.
-         */
-        SimError( char const * format, ... )
-            __attribute__ ((format(printf, 2, 3)));
-        /**
-         * @brief Returns exception message
-         * @return Exception message.
-         */
-        char const * what() const throw ();
+enum class RemainingTimeMode{
+    EVENTS, // Every remaining event counts as 1 time unit
+    TIME    // Remaining ms of P and M events, IO excluded
 };
 
-/**
- * @brief A parsed structure of metadata unit.
- * 
- */
-struct SimEvent
-{
-    char code;
-    std::string descriptor;
-    long int cycles;
-};
-typedef std::deque<SimEvent> Application;
+class Simulation;
+struct MetaDataPart;
 
 /**
- * @brief Scheduling enumeration.
+ * @brief Holds state of one simulated CPU core.
+ * @details Every core has its own run queue and dispatcher thread. Jobs
+ *          are queued on the core process last ran on, idle cores take
+ *          jobs from other cores' queues.
  * 
  */
-enum class SchedulingCode{
-    RR, SRTF
+struct SimCore{
+    Simulation *sim;
+    unsigned int id;
+    char label[24];
+    ReadyQueue jobs;
+    std::atomic<unsigned short> interrupt;
+    std::atomic<bool> tick;
+    std::atomic<bool> idle;
+    unsigned int currentProcess;
+    PCB *running;
+    unsigned long runStart;
+    TimerHandle quantumTimer;
+    pthread_t thread;
+
+    unsigned long dispatches;
+    unsigned long steals;
+    unsigned long dispatchWakeups;
+    double dispatchLatencyTotal;
+    double dispatchLatencyMax;
 };
 
-/**
- * @brief Process state enumeration used in PCB structure.
- * 
- */
-enum class ProcessState{
-    START, READY, RUNNING, WAITING, EXIT
-};
-
-/**
- * @brief Holds information about process in simulation.
- * 
- */
-struct PCB{
-    std::atomic<ProcessState> state;
-    unsigned int pid;
-    Application eventQueue;
-    bool eventInProgress;
-    unsigned long eventTimeRemaining;
-};
-
-/**
- * @brief Used by scheduling (priority) queue to store process id's 
- * 
- */
-struct Job
-{
-    unsigned int pid;
-    int priority;
-    bool operator<(const Job &rhs) const
-    {
-        return priority < rhs.priority;
-    }
-};
-
-
 class Simulation
 {
     public:
-        unsigned int currentProcess;
-        unsigned int processCounter;
-        std::vector<PCB *> processes;
-        std::priority_queue<Job> jobs;
+        ProcessTable processes;
+        std::vector<SimCore *> cores;
         
         /**
          * @brief Constructor for Simulation.
@@ -138,45 +108,139 @@ class Simulation
         /**
          * @brief Runs simulation on a process
          * 
+         * @param core Core the process runs on
          * @param process Pointer to the process PCB
          */
-        void RunProcess( unsigned int pid );
+        void RunProcess( SimCore &core, PCB *process );
+
+        /**
+         * @brief Moves process waiting on IO back into scheduling queue.
+         * @details Called by IO resources when request completes, wakes up
+         *          the dispatcher if it is idle.
+         * 
+         * @param pid The process which finished IO.
+         */
+        void WakeProcess( unsigned int pid );
 
         /**
          * @brief Function used by simulation to log.
          * @details Depending on the config, the log will output to monitor, file, or both.
          *          It uses same format as printf, except it outputs to config specified
-         *          location (monitor/file).
+         *          location (monitor/file). Record is handed to the asynchronous
+         *          logger, it reaches outputs once the writer thread drains it.
          *          
          * @param format,... Structure of log output followed by arguments specified in structure.
          */
         void Log( char const * format, ... )
-            __attribute__ ((format(printf, 2, 3)));;
+            __attribute__ ((format(printf, 2, 3)));
+
+        /**
+         * @brief Logs event of the simulation.
+         * @details Sets time of the first record. In binary log format the
+         *          records are written as they are, otherwise they are
+         *          formatted to a line of text log.
+         *
+         * @param records Records of the event, TraceRecordCount( records[0] ) of them.
+         */
+        void Trace( TraceRecord *records );
+
+        /**
+         * @brief Logs event of the simulation described by a single record.
+         */
+        void Trace( TraceEvent event, unsigned int pid, uint16_t core = TRACE_NO_CORE,
+            TraceDevice device = TraceDevice::COUNT, unsigned int unit = 0, unsigned long address = 0 );
+
+        /**
+         * @brief Returns whether log statements of category and level are enabled by config.
+         * @details Used by SIM_LOG, which also checks what is compiled in.
+         */
+        bool LogEnabled( LogCategory category, LogLevel level ) const;
+
+        /**
+         * @brief Returns core named in trace records of calling thread.
+         * @return Core the thread simulates with more than one CPU, otherwise TRACE_NO_CORE.
+         */
+        uint16_t TraceCore() const;
+
+        /**
+         * @brief Returns current simulation time.
+         * @return Simulation time in ns, TscClock ticks on real clock.
+         */
+        uint64_t simNow();
 
         /**
          * @brief Returns current simulation time.
          * @return Simulation time in seconds.
          */
-        float simTime();
+        double simTime();
+
+        /**
+         * @brief Checks whether simulation runs on virtual clock.
+         * @return True if simulated time is driven by discrete events
+         *         instead of wall-clock.
+         */
+        bool VirtualTime() const;
+
+        /**
+         * @brief Returns current time of virtual clock.
+         * @return Simulated time in ms.
+         */
+        unsigned long VirtualNow() const;
+
+        /**
+         * @brief Schedules callback on simulation timer service.
+         * @details On virtual clock callback fires on the dispatcher thread,
+         *          in real time on the timer thread.
+         * 
+         * @param delay Time in ms from current simulated time.
+         * @param callback Function to call when event fires.
+         * @return Handle to cancel the timer with.
+         */
+        TimerHandle ScheduleEvent( unsigned long delay, std::function<void()> callback );
 
     private:
         SchedulingCode scheduling;
+        RemainingTimeMode remainingTimeMode;
+        bool virtualTime = false;
+        bool virtualMemory = false;
+        PageReplacement pageReplacement;
+        TimerService timers;
 
-        std::unordered_map<std::string, std::string> configKeyValues;
+        std::vector<std::pair<std::string, std::string>> configKeyValues;  // In config file order
         ConfigManager config;
+        SimConfig settings;                 // Typed config options, set by LoadConfig
 
         std::fstream  logFile;
         bool logToFile = false;
         bool logToMonitor = false;
+        bool binaryLog = false;
+        LogLevel logLevel = LogLevel::DETAIL;
+        unsigned int logCategories = ~0u;
+        AsyncLogger logger;
+        TraceEncoder traceEncoder;          // Used by logger writer only
         
-        Application * currentApplication;
-        std::vector<Application *> applications;
+        Program * currentApplication;
+        std::vector<Program *> applications;
         bool osRunning = false;
 
-        unsigned int memoryBlockCounter;
+        bool streamMetaData = false;        // Meta-data is read while the simulation runs
+        bool streamRead = false;            // Streamed programs all read, applications has them
+        unsigned int mdThreads = 1;         // Threads reading meta-data in parallel
+        bool mdCache = false;               // Parsed meta-data is cached in .mdb file
+        MetaDataCache mdCacheFile;          // Cache applications were loaded from, mapped while they run
+        std::vector<Program> cachedPrograms;
+        MetaDataParser mdParser;
+        ProgramQueue streamedPrograms;
+        pthread_t mdReader;
+        bool mdReaderRunning = false;
+        std::exception_ptr mdError;         // Error of streamed meta-data
+
+        pthread_mutex_t memMutex;
+        MemoryManager memory;
+        VirtualMemory vm;
         unsigned int maxMemoryBlocks;
 
-        std::chrono::high_resolution_clock::time_point simStartTime;
+        uint64_t simStartNs;
 
         ResourceHDD         *resHdd;
         ResourcePrinter     *resPrinter;
@@ -184,13 +248,137 @@ class Simulation
         ResourceKeyboard    *resKeyboard;
         ResourceMouse       *resMouse;
         ResourceSpeaker     *resSpeaker;
+        ResourceIO          *ioResources[(size_t)EventDescriptor::COUNT];
 
-        pthread_mutex_t logMutex;
         pthread_mutex_t simMutex;
         std::atomic<bool> loaderFinished;
-        std::atomic<unsigned short> simInterrupt;
+        std::atomic<unsigned int> liveProcesses;
+        unsigned int loaderRound;
+        unsigned long loaderRoundStart;     // Virtual time current loader round started
+        std::atomic<unsigned int> nextCore;
+        std::function<void()> loaderArrival;
+        std::function<void()> schedulerTick;
+        std::function<void()> schedulerBoost;
+        unsigned long boostEpoch;
 
-        unsigned long GetRemainingTime( unsigned int processId );
+        /**
+         * @brief Returns remaining work of a new process running program.
+         * @details Only used when process is created, afterwards remaining
+         *          work is kept up to date by chargeWork and completeEvent.
+         * 
+         * @param program Program process runs
+         * @return Remaining work in units of remainingTimeMode
+         */
+        unsigned long computeRemainingTime( const Program *program ) const;
+
+        /**
+         * @brief Subtracts ms of P or M work done from remaining time of process.
+         * 
+         * @param process Pointer to the process PCB
+         * @param ms Work done in ms
+         */
+        void chargeWork( PCB *process, long int ms );
+
+        /**
+         * @brief Moves process past finished event and updates remaining time.
+         * 
+         * @param process Pointer to the process PCB
+         */
+        void completeEvent( PCB *process );
+
+        /**
+         * @brief Creates processes for every application and pushes them
+         *        into scheduling queue.
+         * @details While meta-data is streamed, creates processes for the
+         *          next batch of streamed programs only, and is called again
+         *          until the round is complete.
+         *
+         * @return False if streamed round has programs left.
+         */
+        bool LoadApplications( );
+
+        /**
+         * @brief Creates process running program and pushes it into scheduling queue.
+         * @details Caller holds simMutex.
+         */
+        void admitProcess( Program *program );
+
+        /**
+         * @brief Loads up to queue depth of streamed programs, keeping them for later rounds.
+         * @details Once meta-data is read, loads every kept program at once.
+         * @return True once the end of meta-data is reached.
+         */
+        bool streamApplications( );
+
+        /**
+         * @brief Drops a hold of streamed program, frees it with the last one.
+         */
+        void releaseProgram( const Program *program );
+
+        /**
+         * @brief Marks loader as finished and wakes up the dispatcher.
+         * @details Releases loader's hold of streamed programs.
+         */
+        void finishLoading( );
+
+        /**
+         * @brief Pushes process into scheduling queue with its key.
+         * @details Safe to call from any thread. Process goes to the core
+         *          it last ran on unless some core is idle, if the chosen
+         *          core is busy an idle core is woken up to steal it.
+         * 
+         * @param process Pointer to the process PCB
+         * @param woken True if process is requeued after its IO finished.
+         */
+        void queueJob( PCB *process, bool woken = false );
+
+        /**
+         * @brief Picks core whose queue process is pushed into.
+         * 
+         * @param process Pointer to the process PCB
+         * @return Core id
+         */
+        unsigned int pickCore( PCB *process );
+
+        /**
+         * @brief Pops process from core's own queue, or steals one from another core.
+         * 
+         * @param core Core looking for work
+         * @param process Set to taken process
+         * @return False if every queue is empty.
+         */
+        bool takeJob( SimCore &core, PCB *&process );
+
+        /**
+         * @brief Handles pending scheduler tick and checks core's interrupts.
+         * @details Ticks are passed to scheduling policy on the dispatcher
+         *          thread, policy raises interrupt if running process should
+         *          be preempted.
+         * 
+         * @param core Core doing the work
+         * @return True if work on the core was interrupted.
+         */
+        bool checkInterrupt( SimCore &core );
+
+        /**
+         * @brief Sets interrupt flag on every core.
+         * 
+         * @param flag SIM_INTERRUPT_* flag
+         */
+        void raiseInterrupt( unsigned short flag );
+
+        /**
+         * @brief Wakes up every idle dispatcher, even if there is nothing to run.
+         */
+        void notifyCores( );
+
+        /**
+         * @brief Dispatcher thread of every core but the first one.
+         * 
+         * @param corePtr Pointer to core to dispatch on.
+         * @return NULL
+         */
+        static void * CoreDispatcher( void * corePtr );
         
         /**
          * @brief A threaded loader function, loads new processes into simulation
@@ -200,19 +388,39 @@ class Simulation
          * @return NULL
          */
         static void * JobLoader( void * simPtr );
-        
+
         /**
-         * @brief A threaded scheduling function, sets SIM_INTERRUPT_SCHEDULER_RR
-         *        flag every 50ms. 
+         * @brief Meta-data reader thread of streamed meta-data, parses it
+         *        into the queue of streamed programs once per loader round.
          * 
          * @param simPtr Pointer to simulation object.
          * @return NULL
          */
-        static void * SchedulerRR( void * simPtr );
+        static void * MetaDataReader( void * simPtr );
+
+        /**
+         * @brief Thread of parallel meta-data read, parses parts until none is left.
+         * 
+         * @param readPtr Pointer to the MetaDataRead of the read.
+         * @return NULL
+         */
+        static void * MetaDataWorker( void * readPtr );
+        
+
+        /**
+         * @brief Pops next job from scheduling queue and runs it.
+         * @details Blocks while no process is ready (on virtual clock skips
+         *          to next event instead). Process is then re-added into
+         *          scheduling queue, or put on wait list if it waits on IO.
+         * 
+         * @param core Core to dispatch on
+         * @return False once every process completed and loader is done.
+         */
+        bool DispatchNextJob( SimCore &core );
 
         /**
          * @brief Does simulation work.
-         * @details Basically while loop that checks time elapsed.
+         * @details Blocks calling thread until timer fires, real time only.
          * 
          * @param ms miliseconds to do work for.
          */
@@ -222,11 +430,12 @@ class Simulation
          * @brief Does simulation work for processes.
          * @details Similarly to doWork, but can be interrupted.
          * 
+         * @param core Core doing the work, its interrupts stop the work.
          * @param ms miliseconds to do work for.
          * 
          * @return remaining time in ms
          */
-        long int doProcWork( long int ms );
+        long int doProcWork( SimCore &core, long int ms );
 
         /**
          * @brief Resets simulation timer.
@@ -235,7 +444,7 @@ class Simulation
 
         /**
          * @brief Reads the configuration file.
-         * @details Reads configuration files an populates configKeyValues map.
+         * @details Reads configuration files an populates configKeyValues.
          *          It doesn't check if individual configuration values are valid
          *          or not.
          * 
@@ -246,7 +455,7 @@ class Simulation
         /**
          * @brief Loads configuration into simulation.
          * 
-         * @details Loads individual configuration values from configKeyValues map into
+         * @details Loads individual configuration values from configKeyValues into
          *          simulation. It checks whether config values are valid or not. And 
          *          opens log file for writing if specified by the config.
          * 
@@ -254,47 +463,149 @@ class Simulation
         void LoadConfig( );
 
         /**
-         * @brief Loads meta-data into a queue.
-         * @details Reads the meta-data from a file, specified by configuration, and loads it into a eventQueue.
+         * @brief Loads meta-data into program images.
+         * @details Reads the meta-data from a file, specified by configuration, and loads every application
+         *          in it into a Program shared by all processes running it. Streamed meta-data is only
+         *          opened, MetaDataReader reads it once the simulation runs.
          * 
          */
         void ReadMetaData( );
 
         /**
-         * @brief Adds meta-data event to a eventQueue.
-         * @details Adds meta-data event to a eventQueue. Other than adding the event into a queue, 
+         * @brief Loads applications from cache of opened meta-data file.
+         * 
+         * @param path Path of the cache.
+         * @param hash Hash of the meta-data file.
+         * @return False if cache is missing, stale or malformed, nothing is loaded then.
+         */
+        bool loadMetaDataCache( const std::string &path, uint64_t hash );
+
+        /**
+         * @brief Parses opened meta-data file, every application is added by AddEvent.
+         * @details Large meta-data is parsed by mdThreads threads when it is
+         *          valid, otherwise it is parsed again by one thread to
+         *          report the first error.
+         */
+        void parseMetaData( );
+
+        /**
+         * @brief Parses meta-data in parts on threads and merges the applications in order.
+         * @return False if meta-data is not valid, nothing is loaded then.
+         */
+        bool parseMetaDataParallel( unsigned int threads );
+
+        /**
+         * @brief Parses part of meta-data, its applications are merged later.
+         */
+        void parsePart( MetaDataPart &part );
+
+        /**
+         * @brief Adds applications of parsed parts in order, checking nesting of S and A events.
+         * @details Throws SimError of the first event out of order.
+         * 
+         * @return False if a part failed or meta-data does not end correctly.
+         */
+        bool mergeParts( std::vector<MetaDataPart> &parts );
+
+        /**
+         * @brief Adds meta-data event to the current program.
+         * @details Adds meta-data event to the current program. Other than adding the event into a program, 
          *          it also checks if descriptor and cycles are valid.
          * 
          * @param code Event code.
          * @param descriptor Event descriptor.
          * @param cycles Event cycles.
          */
-        void AddEvent( char code, std::string &descriptor, long int cycles );
+        void AddEvent( char code, std::string_view descriptor, long int cycles );
+
+        /**
+         * @brief Checks code, descriptor and cycles of meta-data event, independent of other events.
+         * 
+         * @return The event.
+         */
+        SimEvent checkEvent( char code, std::string_view descriptor, long int cycles ) const;
+
+        /**
+         * @brief Adds checked event to the current program, checking it against events before it.
+         * 
+         * @param event Event.
+         * @param program Program started by A(start) event, a new one if NULL.
+         */
+        void addEvent( const SimEvent &event, Program *program = NULL );
+
+        /**
+         * @brief Logs event of process running on core.
+         */
+        void trace( TraceEvent event, unsigned int pid, const SimCore &core, unsigned long address = 0, unsigned int unit = 0 );
+
+        /**
+         * @brief Returns core named in trace records of process running on core.
+         */
+        uint16_t traceCore( const SimCore &core ) const;
+
+        /**
+         * @brief Logs page fault of process running on core, with the page evicted if any.
+         */
+        void tracePageFault( const SimCore &core, unsigned int pid, unsigned long page, const PageFault &fault );
 
         /**
          * @brief Processes processor event
+         * @param core Core the process runs on.
          * @param event Event data.
          */
-        void handleProc( unsigned int pid, const SimEvent &event  );
+        void handleProc( SimCore &core, PCB *process, const SimEvent &event  );
 
         /**
          * @brief Processes memory event
+         * @param core Core the process runs on.
+         * @param event Event data.
+         */
+        void handleMem( SimCore &core, PCB *process, const SimEvent &event  );
+
+        /**
+         * @brief Processes memory event in virtual memory mode
+         * @details Every cycle touches a page, allocation touches the page
+         *          it adds, blocking sweeps all pages of the process. Page
+         *          fault stops the event until hard drive loads the page.
+         * @param core Core the process runs on.
          * @param event Event data.
          */
-        void handleMem( unsigned int pid, const SimEvent &event  );
+        void handlePagedMem( SimCore &core, PCB *process, const SimEvent &event  );
+
+        /**
+         * @brief Queues page-in of faulted page on hard drive.
+         * @param core Core the process runs on.
+         * @return True if process now waits for the page, false if interrupted first.
+         */
+        bool requestPageIn( SimCore &core, PCB *process );
 
         /**
          * @brief Processes IO event
+         * @param core Core the process runs on.
          * @param event Event data.
          */
-        void handleIO( unsigned int pid, const SimEvent &event  );
+        void handleIO( SimCore &core, PCB *process, const SimEvent &event  );
         
         /**
-         * @brief Assigns memory and returns address
+         * @brief Assigns memory to process
+         * @param pid Process memory belongs to
          * @param totMem amount of memory in kb
-         * @return Memory address
+         * @param address Memory address
+         * @return False if memory is exhausted
          */
-        unsigned int allocateMemory( int totMem );
+        bool allocateMemory( unsigned int pid, int totMem, unsigned int &address );
+
+        /**
+         * @brief Frees all memory of process, logs its paging in virtual memory mode
+         * @param core Core the process ran on
+         * @param pid Process memory belongs to
+         */
+        void freeMemory( SimCore &core, unsigned int pid );
 };
 
+inline bool Simulation::LogEnabled( LogCategory category, LogLevel level ) const
+{
+    return level <= logLevel && (logCategories >> (unsigned int)category) & 1;
+}
+
 #endif // _SIMULATION
@@ -0,0 +1,529 @@
+#include "TimerService.h"
+
+#include <stdexcept>
+#include <string>
+#include <ctime>
+#include <cerrno>
+
+namespace {
+    const unsigned long TIMER_CHUNK = 1024;
+    const unsigned long MAX_DELTA = (1UL << (TimerWheel::LEVELS * TimerWheel::SLOT_BITS)) - 1;
+
+    /**
+     * @brief Returns index of first set bit at or after start, wrapping around.
+     */
+    unsigned int firstSlotFrom( unsigned long long mask, unsigned int start )
+    {
+        unsigned long long rotated = start ? (mask >> start) | (mask << (TimerWheel::SLOTS - start)) : mask;
+        return (start + __builtin_ctzll(rotated)) % TimerWheel::SLOTS;
+    }
+
+    /**
+     * @brief Detaches leading run of list in generation order.
+     */
+    Timer *takeRun( Timer *&list )
+    {
+        Timer *run = list;
+        Timer *last = list;
+        while( last->next && last->next->generation > last->generation )
+            last = last->next;
+        list = last->next;
+        last->next = NULL;
+        return run;
+    }
+
+    /**
+     * @brief Merges two lists in generation order.
+     */
+    Timer *mergeRuns( Timer *a, Timer *b )
+    {
+        Timer *head = NULL;
+        Timer **tail = &head;
+        while( a && b )
+        {
+            if( b->generation < a->generation )
+            {
+                *tail = b;
+                b = b->next;
+            }
+            else
+            {
+                *tail = a;
+                a = a->next;
+            }
+            tail = &(*tail)->next;
+        }
+        *tail = a ? a : b;
+        return head;
+    }
+}
+
+TimerWheel::TimerWheel():
+    current(0),
+    generationCounter(0),
+    count(0),
+    freeTimers(NULL)
+{
+    for( unsigned int l = 0; l < LEVELS; ++l )
+    {
+        occupied[l] = 0;
+        for( unsigned int s = 0; s < SLOTS; ++s )
+            slots[l][s] = NULL;
+    }
+}
+
+TimerWheel::~TimerWheel()
+{
+    for( auto it = chunks.begin(); it != chunks.end(); ++it )
+        delete [] *it;
+}
+
+void TimerWheel::Reset( )
+{
+    for( unsigned int l = 0; l < LEVELS; ++l )
+    {
+        for( unsigned int s = 0; s < SLOTS; ++s )
+        {
+            while( slots[l][s] )
+            {
+                Timer *timer = slots[l][s];
+                unlink( timer );
+                Release( timer );
+            }
+        }
+    }
+    current = 0;
+}
+
+unsigned long TimerWheel::Current( ) const
+{
+    return current;
+}
+
+size_t TimerWheel::Size( ) const
+{
+    return count;
+}
+
+TimerHandle TimerWheel::Add( unsigned long expires, std::function<void()> callback )
+{
+    if( !freeTimers )
+    {
+        Timer *chunk = new Timer[TIMER_CHUNK];
+        chunks.push_back( chunk );
+        for( unsigned long i = 0; i < TIMER_CHUNK; ++i )
+        {
+            chunk[i].next = freeTimers;
+            freeTimers = &chunk[i];
+        }
+    }
+    Timer *timer = freeTimers;
+    freeTimers = timer->next;
+
+    timer->expires = expires < current ? current : expires;
+    timer->generation = ++generationCounter;
+    timer->callback = callback;
+    link( timer );
+
+    return TimerHandle{timer, timer->generation};
+}
+
+bool TimerWheel::Cancel( TimerHandle handle )
+{
+    Timer *timer = handle.timer;
+    if( !timer || !timer->armed || timer->generation != handle.generation )
+        return false;
+    unlink( timer );
+    Release( timer );
+    return true;
+}
+
+void TimerWheel::link( Timer *timer )
+{
+    unsigned long delta = timer->expires - current;
+    unsigned long slotTime = timer->expires;
+    if( delta > MAX_DELTA )
+    {
+        // Too far for the wheel, park it at the end and re-add on cascade
+        delta = MAX_DELTA;
+        slotTime = current + MAX_DELTA;
+    }
+
+    unsigned int level = 0;
+    while( level + 1 < LEVELS && delta >= (1UL << (SLOT_BITS * (level + 1))) )
+        ++level;
+    unsigned int slot = (slotTime >> (SLOT_BITS * level)) & (SLOTS - 1);
+
+    // Append, so timers in a slot keep their order
+    timer->level = level;
+    timer->slot = slot;
+    timer->next = NULL;
+    Timer *head = slots[level][slot];
+    if( head )
+    {
+        timer->prev = head->prev;
+        head->prev->next = timer;
+        head->prev = timer;
+    }
+    else
+    {
+        timer->prev = timer;
+        slots[level][slot] = timer;
+        occupied[level] |= 1ULL << slot;
+    }
+    timer->armed = true;
+    ++count;
+}
+
+void TimerWheel::unlink( Timer *timer )
+{
+    Timer *&head = slots[timer->level][timer->slot];
+    if( timer == head )
+    {
+        head = timer->next;
+        if( head )
+            head->prev = timer->prev;
+        else
+            occupied[timer->level] &= ~(1ULL << timer->slot);
+    }
+    else
+    {
+        timer->prev->next = timer->next;
+        if( timer->next )
+            timer->next->prev = timer->prev;
+        else
+            head->prev = timer->prev;
+    }
+    timer->armed = false;
+    --count;
+}
+
+void TimerWheel::cascade( unsigned int level, unsigned int slot )
+{
+    Timer *timer = slots[level][slot];
+    slots[level][slot] = NULL;
+    occupied[level] &= ~(1ULL << slot);
+
+    while( timer )
+    {
+        Timer *next = timer->next;
+        --count;
+        link( timer );
+        timer = next;
+    }
+}
+
+unsigned long TimerWheel::NextTick( ) const
+{
+    unsigned long next = (unsigned long)-1;
+
+    if( occupied[0] )
+    {
+        unsigned int index = current & (SLOTS - 1);
+        unsigned int slot = firstSlotFrom( occupied[0], index );
+        next = current + ((slot - index) & (SLOTS - 1));
+    }
+
+    for( unsigned int level = 1; level < LEVELS; ++level )
+    {
+        if( !occupied[level] )
+            continue;
+
+        // Slot cascades when lower levels wrap and this level points at it
+        unsigned int shift = SLOT_BITS * level;
+        unsigned int index = (current >> shift) & (SLOTS - 1);
+        unsigned int slot = firstSlotFrom( occupied[level], (index + 1) % SLOTS );
+        unsigned long rotation = 1UL << (shift + SLOT_BITS);
+        unsigned long tick = (current & ~(rotation - 1)) + ((unsigned long)slot << shift);
+        if( tick <= current )
+            tick += rotation;
+        if( tick < next )
+            next = tick;
+    }
+    return next;
+}
+
+void TimerWheel::Advance( unsigned long tick )
+{
+    if( tick <= current )
+        return;
+
+    current = tick;
+    for( unsigned int level = 1; level < LEVELS; ++level )
+    {
+        unsigned int shift = SLOT_BITS * level;
+        if( current & ((1UL << shift) - 1) )
+            break;
+        cascade( level, (current >> shift) & (SLOTS - 1) );
+    }
+}
+
+Timer *TimerWheel::Expire( )
+{
+    unsigned int slot = current & (SLOTS - 1);
+    Timer *expired = slots[0][slot];
+    slots[0][slot] = NULL;
+    occupied[0] &= ~(1ULL << slot);
+
+    for( Timer *timer = expired; timer; timer = timer->next )
+    {
+        timer->armed = false;
+        --count;
+    }
+
+    // Cascaded timers are appended after ones added directly to level 0, so
+    // the list is a few runs in scheduling order. Merge them pairwise, one
+    // pass over a list that is in order already.
+    while( expired )
+    {
+        Timer *merged = NULL;
+        Timer **tail = &merged;
+        bool single = true;
+        while( expired )
+        {
+            Timer *run = takeRun( expired );
+            if( expired )
+            {
+                run = mergeRuns( run, takeRun( expired ) );
+                single = false;
+            }
+            *tail = run;
+            while( *tail )
+                tail = &(*tail)->next;
+        }
+        if( single )
+            return merged;
+        expired = merged;
+    }
+    return NULL;
+}
+
+void TimerWheel::Release( Timer *timer )
+{
+    timer->callback = nullptr;
+    timer->armed = false;
+    timer->next = freeTimers;
+    freeTimers = timer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TimerService::TimerService():
+    virtualTime(true),
+    running(false)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&wakeup, &attr);
+    pthread_cond_init(&sleepers, NULL);
+    pthread_condattr_destroy(&attr);
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+}
+
+TimerService::~TimerService()
+{
+    Stop();
+    pthread_cond_destroy(&sleepers);
+    pthread_cond_destroy(&wakeup);
+    pthread_mutex_destroy(&mutex);
+}
+
+void TimerService::Start( bool virtualTime )
+{
+    Stop();
+
+    pthread_mutex_lock(&mutex);
+    wheel.Reset();
+    this->virtualTime = virtualTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    pthread_mutex_unlock(&mutex);
+
+    if( !virtualTime )
+    {
+        running = true;
+        int rc = pthread_create(&thread, NULL, timerThread, this);
+        if( rc )
+            throw std::runtime_error( "Unable to create timer thread, error code (" + std::to_string(rc) +")." );
+    }
+}
+
+void TimerService::Stop( )
+{
+    pthread_mutex_lock(&mutex);
+    bool joinThread = running;
+    running = false;
+    pthread_cond_signal(&wakeup);
+    pthread_mutex_unlock(&mutex);
+
+    if( joinThread )
+        pthread_join(thread, NULL);
+
+    pthread_mutex_lock(&mutex);
+    unsigned long now = wheel.Current();
+    wheel.Reset();
+    // Keep virtual time where it was, log after Stop still needs it
+    if( virtualTime )
+        wheel.Advance( now );
+    pthread_mutex_unlock(&mutex);
+}
+
+unsigned long TimerService::elapsed( ) const
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - startTime.tv_sec) * 1000 + (now.tv_nsec - startTime.tv_nsec) / 1000000;
+}
+
+unsigned long TimerService::Now( ) const
+{
+    if( !virtualTime )
+        return elapsed();
+
+    pthread_mutex_lock(&mutex);
+    unsigned long now = wheel.Current();
+    pthread_mutex_unlock(&mutex);
+    return now;
+}
+
+TimerHandle TimerService::Schedule( unsigned long delay, std::function<void()> callback )
+{
+    pthread_mutex_lock(&mutex);
+    unsigned long now = virtualTime ? wheel.Current() : elapsed();
+    TimerHandle handle = wheel.Add( now + delay, callback );
+    if( !virtualTime )
+        pthread_cond_signal(&wakeup);
+    pthread_mutex_unlock(&mutex);
+    return handle;
+}
+
+bool TimerService::Cancel( TimerHandle handle )
+{
+    pthread_mutex_lock(&mutex);
+    bool cancelled = wheel.Cancel( handle );
+    pthread_mutex_unlock(&mutex);
+    return cancelled;
+}
+
+void TimerService::SleepFor( unsigned long ms )
+{
+    if( virtualTime )
+        throw std::logic_error( "TimerService::SleepFor Attempt to block on virtual clock" );
+
+    bool fired = false;
+    bool *firedPtr = &fired;
+    Schedule( ms, [this, firedPtr]{
+        pthread_mutex_lock(&mutex);
+        *firedPtr = true;
+        pthread_cond_broadcast(&sleepers);
+        pthread_mutex_unlock(&mutex);
+    });
+
+    pthread_mutex_lock(&mutex);
+    while( !fired )
+        pthread_cond_wait(&sleepers, &mutex);
+    pthread_mutex_unlock(&mutex);
+}
+
+size_t TimerService::Pending( ) const
+{
+    pthread_mutex_lock(&mutex);
+    size_t pending = wheel.Size();
+    pthread_mutex_unlock(&mutex);
+    return pending;
+}
+
+bool TimerService::HasEvents( ) const
+{
+    return Pending() > 0;
+}
+
+unsigned long TimerService::NextEventTime( ) const
+{
+    pthread_mutex_lock(&mutex);
+    unsigned long next = wheel.NextTick();
+    pthread_mutex_unlock(&mutex);
+    return next;
+}
+
+bool TimerService::AdvanceToNext( )
+{
+    pthread_mutex_lock(&mutex);
+    if( wheel.Size() == 0 )
+    {
+        pthread_mutex_unlock(&mutex);
+        return false;
+    }
+    wheel.Advance( wheel.NextTick() );
+    fire( wheel.Expire() );
+
+    // Callbacks may schedule new timers for the current tick, those fire too
+    while( wheel.Size() && wheel.NextTick() == wheel.Current() )
+        fire( wheel.Expire() );
+    pthread_mutex_unlock(&mutex);
+    return true;
+}
+
+void TimerService::AdvanceTo( unsigned long time )
+{
+    pthread_mutex_lock(&mutex);
+    if( wheel.Size() && wheel.NextTick() < time )
+        time = wheel.NextTick();
+    wheel.Advance( time );
+    pthread_mutex_unlock(&mutex);
+}
+
+void TimerService::fire( Timer *expired )
+{
+    pthread_mutex_unlock(&mutex);
+    for( Timer *timer = expired; timer; timer = timer->next )
+        timer->callback();
+    pthread_mutex_lock(&mutex);
+
+    while( expired )
+    {
+        Timer *next = expired->next;
+        wheel.Release( expired );
+        expired = next;
+    }
+}
+
+void *TimerService::timerThread( void *servicePtr )
+{
+    TimerService *service = (TimerService *)servicePtr;
+
+    pthread_mutex_lock(&service->mutex);
+    while( service->running )
+    {
+        if( service->wheel.Size() == 0 )
+        {
+            pthread_cond_wait(&service->wakeup, &service->mutex);
+            continue;
+        }
+
+        unsigned long next = service->wheel.NextTick();
+        if( service->elapsed() < next )
+        {
+            // Sleep until due, or until earlier timer is scheduled
+            struct timespec deadline = service->startTime;
+            deadline.tv_sec += next / 1000;
+            deadline.tv_nsec += (next % 1000) * 1000000;
+            if( deadline.tv_nsec >= 1000000000 )
+            {
+                deadline.tv_sec += 1;
+                deadline.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&service->wakeup, &service->mutex, &deadline);
+            continue;
+        }
+
+        service->wheel.Advance( next );
+        service->fire( service->wheel.Expire() );
+    }
+    pthread_mutex_unlock(&service->mutex);
+
+    return NULL;
+}
@@ -0,0 +1,249 @@
+#ifndef _TIMER_SERVICE
+#define _TIMER_SERVICE
+
+#include <functional>
+#include <vector>
+
+#include <pthread.h>
+
+/**
+ * @brief Timer node stored in TimerWheel slots.
+ *
+ */
+struct Timer
+{
+	unsigned long expires;
+	unsigned long generation;
+	std::function<void()> callback;
+	Timer *prev;
+	Timer *next;
+	unsigned char level;
+	unsigned char slot;
+	bool armed;
+};
+
+/**
+ * @brief Handle returned by TimerService::Schedule, used to cancel timer.
+ * @details Timer nodes are recycled, generation tells whether handle still
+ * 			refers to the timer it was created for.
+ *
+ */
+struct TimerHandle
+{
+	Timer *timer;
+	unsigned long generation;
+};
+
+/**
+ * @brief Hierarchical timing wheel with 1 ms ticks.
+ * @details Four levels of 64 slots each, level L slot spans 64^L ticks.
+ * 			Timers are inserted and removed in O(1), timers on higher
+ * 			levels are cascaded down when lower level wraps. Each level
+ * 			keeps a bitmap of occupied slots, so next tick with work to do
+ * 			is found without walking empty slots. Not thread-safe.
+ *
+ */
+class TimerWheel
+{
+	public:
+		static const unsigned int LEVELS = 4;
+		static const unsigned int SLOT_BITS = 6;
+		static const unsigned int SLOTS = 1 << SLOT_BITS;
+
+		TimerWheel();
+		~TimerWheel();
+
+		/**
+		 * @brief Removes all timers and moves wheel back to tick 0.
+		 */
+		void Reset( );
+
+		/**
+		 * @brief Returns tick the wheel is at.
+		 */
+		unsigned long Current( ) const;
+
+		/**
+		 * @brief Returns number of armed timers.
+		 */
+		size_t Size( ) const;
+
+		/**
+		 * @brief Arms new timer.
+		 *
+		 * @param expires Tick to fire at, past ticks fire on current tick.
+		 * @param callback Function to call when timer fires.
+		 * @return Handle of the timer.
+		 */
+		TimerHandle Add( unsigned long expires, std::function<void()> callback );
+
+		/**
+		 * @brief Disarms timer if it did not fire yet.
+		 *
+		 * @param handle Handle returned by Add.
+		 * @return True if timer was disarmed.
+		 */
+		bool Cancel( TimerHandle handle );
+
+		/**
+		 * @brief Returns next tick the wheel has work on.
+		 * @details Either a tick with expiring timers or a tick where timers
+		 * 			cascade down from higher level, never later than next
+		 * 			expiry. Undefined if wheel is empty.
+		 */
+		unsigned long NextTick( ) const;
+
+		/**
+		 * @brief Moves wheel to tick, cascading timers that become due.
+		 * @details Tick must be between Current and NextTick.
+		 *
+		 * @param tick Tick to move to.
+		 */
+		void Advance( unsigned long tick );
+
+		/**
+		 * @brief Detaches timers expiring on current tick.
+		 * @details Detached timers are disarmed, caller fires them and returns
+		 * 			them with Release.
+		 *
+		 * @return Linked list of expired timers (through next), may be NULL.
+		 */
+		Timer *Expire( );
+
+		/**
+		 * @brief Returns fired timer node to the pool.
+		 */
+		void Release( Timer *timer );
+
+	private:
+		Timer *slots[LEVELS][SLOTS];
+		unsigned long long occupied[LEVELS];
+		unsigned long current;
+		unsigned long generationCounter;
+		size_t count;
+
+		Timer *freeTimers;
+		std::vector<Timer *> chunks;
+
+		void link( Timer *timer );
+		void unlink( Timer *timer );
+		void cascade( unsigned int level, unsigned int slot );
+};
+
+/**
+ * @brief Single timer service for all timed events of the simulation.
+ * @details In real time the service owns one thread which sleeps until the
+ * 			next timer is due and fires callbacks from it, callbacks should
+ * 			be short. On virtual clock there is no thread, time only moves
+ * 			when simulation advances it and callbacks fire on caller thread.
+ *
+ */
+class TimerService
+{
+	public:
+		TimerService();
+		~TimerService();
+
+		/**
+		 * @brief Drops all timers and starts the clock from 0.
+		 *
+		 * @param virtualTime Whether clock is virtual or wall-clock.
+		 */
+		void Start( bool virtualTime );
+
+		/**
+		 * @brief Stops timer thread and drops all timers, time is left unchanged.
+		 */
+		void Stop( );
+
+		/**
+		 * @brief Returns current time.
+		 * @return Time in ms since Start.
+		 */
+		unsigned long Now( ) const;
+
+		/**
+		 * @brief Schedules callback to be fired after delay.
+		 * @details Timers due on the same tick fire in the order they
+		 * 			were scheduled.
+		 *
+		 * @param delay Time in ms from now.
+		 * @param callback Function to call when timer fires.
+		 * @return Handle to cancel the timer with.
+		 */
+		TimerHandle Schedule( unsigned long delay, std::function<void()> callback );
+
+		/**
+		 * @brief Cancels timer if it did not fire yet.
+		 * @return True if timer was cancelled.
+		 */
+		bool Cancel( TimerHandle handle );
+
+		/**
+		 * @brief Blocks calling thread for given time. Real time only.
+		 *
+		 * @param ms Time in ms.
+		 */
+		void SleepFor( unsigned long ms );
+
+		/**
+		 * @brief Returns number of pending timers.
+		 */
+		size_t Pending( ) const;
+
+		/**
+		 * @brief Checks whether any timer is pending.
+		 */
+		bool HasEvents( ) const;
+
+		/**
+		 * @brief Returns time of next tick with pending work. Virtual clock only.
+		 * @details Never later than the earliest pending timer.
+		 */
+		unsigned long NextEventTime( ) const;
+
+		/**
+		 * @brief Moves virtual clock to next tick with pending work and fires
+		 * 		  timers due on it.
+		 *
+		 * @return False if there were no timers.
+		 */
+		bool AdvanceToNext( );
+
+		/**
+		 * @brief Moves virtual clock forward without firing timers.
+		 * @details Time is never moved backwards and never past pending work.
+		 *
+		 * @param time Time in ms.
+		 */
+		void AdvanceTo( unsigned long time );
+
+	private:
+		TimerWheel wheel;
+		bool virtualTime;
+		bool running;
+		struct timespec startTime;
+
+		mutable pthread_mutex_t mutex;
+		pthread_cond_t wakeup;
+		pthread_cond_t sleepers;
+		pthread_t thread;
+
+		/**
+		 * @brief Returns wall-clock time in ms since Start.
+		 */
+		unsigned long elapsed( ) const;
+
+		/**
+		 * @brief Fires every timer in list and releases it.
+		 * @details Called with mutex held, releases it while callbacks run.
+		 */
+		void fire( Timer *expired );
+
+		/**
+		 * @brief pthread function of real time timer thread.
+		 */
+		static void *timerThread( void *servicePtr );
+};
+
+#endif // _TIMER_SERVICE
@@ -0,0 +1,274 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <cstring>
+
+TraceHeader MakeTraceHeader( )
+{
+    TraceHeader header;
+    memcpy( header.magic, TRACE_MAGIC, sizeof header.magic );
+    header.version = TRACE_VERSION;
+    header.reserved = 0;
+    return header;
+}
+
+/**
+ * @brief Appends value as LEB128 varint, returns bytes written.
+ */
+static size_t putVarint( char *out, uint64_t value )
+{
+    size_t length = 0;
+    while( value >= 0x80 )
+    {
+        out[length++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (char)value;
+    return length;
+}
+
+/**
+ * @brief Reads LEB128 varint, returns bytes read, 0 if data ends inside it.
+ */
+static size_t getVarint( const char *data, size_t size, uint64_t &value )
+{
+    value = 0;
+    for( size_t i = 0; i < size && i < 10; ++i )
+    {
+        value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+        if( !(data[i] & 0x80) )
+            return i + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Tells which fields an event prints, beyond its time.
+ */
+static bool hasPid( TraceEvent event )
+{
+    return event != TraceEvent::SIM_START && event != TraceEvent::SIM_END && event != TraceEvent::TEXT;
+}
+
+static bool hasAddress( TraceEvent event )
+{
+    return event == TraceEvent::MEM_ALLOCATED || event == TraceEvent::PAGE_FAULT
+        || event == TraceEvent::PAGE_FAULT_EVICT || event == TraceEvent::PAGE_EVICTED;
+}
+
+static bool hasUnit( TraceEvent event )
+{
+    return event == TraceEvent::PAGE_FAULT || event == TraceEvent::PAGE_FAULT_EVICT
+        || event == TraceEvent::IO_START || event == TraceEvent::IO_END;
+}
+
+TraceEncoder::TraceEncoder():
+    lastTime(0)
+{
+
+}
+
+size_t TraceEncoder::Encode( const TraceRecord *records, char *out )
+{
+    const TraceRecord &record = records[0];
+    size_t length = 0;
+    out[length++] = (char)record.event;
+
+    if( record.event == TraceEvent::TEXT )
+    {
+        length += putVarint( out + length, record.unit );
+        memcpy( out + length, &records[1], record.unit );
+        return length + record.unit;
+    }
+
+    // Lines of different CPUs may be written slightly out of time order
+    int64_t delta = (int64_t)(record.time - lastTime);
+    lastTime = record.time;
+    uint64_t scale = 0;
+    while( delta && delta % 10 == 0 && scale < 15 )
+    {
+        delta /= 10;
+        ++scale;
+    }
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    length += putVarint( out + length, (zigzag << 4) | scale );
+
+    if( hasPid( record.event ) )
+    {
+        length += putVarint( out + length, record.pid );
+        length += putVarint( out + length, (uint16_t)(record.core + 1) );
+    }
+    if( record.event == TraceEvent::IO_START || record.event == TraceEvent::IO_END )
+        out[length++] = (char)record.device;
+    if( hasAddress( record.event ) )
+        length += putVarint( out + length, record.address );
+    if( hasUnit( record.event ) )
+        length += putVarint( out + length, record.unit );
+    if( record.event == TraceEvent::PAGE_FAULT_EVICT )
+    {
+        length += putVarint( out + length, records[1].pid );
+        length += putVarint( out + length, records[1].address );
+    }
+    return length;
+}
+
+long DecodeTrace( const char *data, size_t size, uint64_t &lastTime, TraceRecord *records, size_t capacity )
+{
+    if( !size )
+        return 0;
+    TraceRecord &record = records[0];
+    record = TraceRecord{ lastTime, 0, 0, (TraceEvent)data[0], TraceDevice::COUNT, TRACE_NO_CORE, 0, 0 };
+    if( record.event >= TraceEvent::COUNT )
+        return -1;
+
+    size_t pos = 1;
+    uint64_t value;
+    size_t used;
+    #define GET_VARINT( target ) \
+        if( !(used = getVarint( data + pos, size - pos, value )) ) \
+            return size - pos >= 10 ? -1 : 0; \
+        pos += used; \
+        target = value;
+
+    if( record.event == TraceEvent::TEXT )
+    {
+        GET_VARINT( record.unit );
+        if( TraceRecordCount( record ) > capacity )
+            return -1;
+        if( size - pos < record.unit )
+            return 0;
+        memcpy( &records[1], data + pos, record.unit );
+        return pos + record.unit;
+    }
+
+    uint64_t packed;
+    GET_VARINT( packed );
+    int64_t delta = (int64_t)((packed >> 4) >> 1) ^ -(int64_t)((packed >> 4) & 1);
+    for( uint64_t scale = packed & 15; scale; --scale )
+        delta *= 10;
+    record.time = lastTime + delta;
+
+    if( hasPid( record.event ) )
+    {
+        GET_VARINT( record.pid );
+        GET_VARINT( record.core );
+        --record.core;
+    }
+    if( record.event == TraceEvent::IO_START || record.event == TraceEvent::IO_END )
+    {
+        if( pos == size )
+            return 0;
+        record.device = (TraceDevice)data[pos++];
+        if( record.device >= TraceDevice::COUNT )
+            return -1;
+    }
+    if( hasAddress( record.event ) )
+    {
+        GET_VARINT( record.address );
+    }
+    if( hasUnit( record.event ) )
+    {
+        GET_VARINT( record.unit );
+    }
+    if( record.event == TraceEvent::PAGE_FAULT_EVICT )
+    {
+        if( capacity < 2 )
+            return -1;
+        records[1] = TraceRecord{ record.time, 0, 0, TraceEvent::PAGE_EVICTED, TraceDevice::COUNT, TRACE_NO_CORE, 0, 0 };
+        GET_VARINT( records[1].pid );
+        GET_VARINT( records[1].address );
+    }
+    #undef GET_VARINT
+
+    lastTime = record.time;
+    return pos;
+}
+
+int FormatDevice( char *name, size_t size, TraceDevice device, unsigned int unit )
+{
+    switch( device )
+    {
+        case TraceDevice::HDD_INPUT:  return snprintf( name, size, "hard drive input on HDD %u", unit );
+        case TraceDevice::HDD_OUTPUT: return snprintf( name, size, "hard drive output on HDD %u", unit );
+        case TraceDevice::PRINTER:    return snprintf( name, size, "printer output on PRNTR %u", unit );
+        case TraceDevice::SPEAKER:    return snprintf( name, size, "speaker output on SPKR %u", unit );
+        case TraceDevice::MONITOR:    return snprintf( name, size, "monitor output" );
+        case TraceDevice::KEYBOARD:   return snprintf( name, size, "keyboard input" );
+        case TraceDevice::MOUSE:      return snprintf( name, size, "mouse input" );
+        default:                      return snprintf( name, size, "device %u", (unsigned int)device );
+    }
+}
+
+size_t TraceRecordCount( const TraceRecord &record )
+{
+    if( record.event == TraceEvent::PAGE_FAULT_EVICT )
+        return 2;
+    if( record.event == TraceEvent::TEXT )
+        return 1 + (record.unit + sizeof(TraceRecord) - 1) / sizeof(TraceRecord);
+    return 1;
+}
+
+int FormatTrace( char *line, size_t size, const TraceRecord *records )
+{
+    const TraceRecord &record = records[0];
+    double time = record.time / 1e9;
+    unsigned int pid = record.pid;
+
+    char label[16] = "";
+    if( record.core != TRACE_NO_CORE )
+        snprintf( label, sizeof label, " on CPU %u", (unsigned int)record.core );
+
+    switch( record.event )
+    {
+        case TraceEvent::SIM_START:
+            return snprintf( line, size, "%lf - Simulator program starting\n", time );
+        case TraceEvent::SIM_END:
+            return snprintf( line, size, "%lf - Simulator program ending\n", time );
+        case TraceEvent::PREPARE:
+            return snprintf( line, size, "%lf - OS: preparing process %u\n", time, pid );
+        case TraceEvent::START_PROCESS:
+            return snprintf( line, size, "%lf - OS: starting process %u%s\n", time, pid, label );
+        case TraceEvent::COMPLETED:
+            return snprintf( line, size, "%lf - Process %u completed%s\n", time, pid, label );
+        case TraceEvent::PROC_START:
+            return snprintf( line, size, "%lf - Process %u: start processing action%s\n", time, pid, label );
+        case TraceEvent::PROC_INTERRUPT:
+            return snprintf( line, size, "%lf - Process %u: interrupt processing action%s\n", time, pid, label );
+        case TraceEvent::PROC_END:
+            return snprintf( line, size, "%lf - Process %u: end processing action%s\n", time, pid, label );
+        case TraceEvent::MEM_ALLOCATING:
+            return snprintf( line, size, "%lf - Process %u: allocating memory%s\n", time, pid, label );
+        case TraceEvent::MEM_ALLOCATED:
+            return snprintf( line, size, "%lf - Process %u: memory allocated at 0x%08lx%s\n", time, pid,
+                (unsigned long)record.address, label );
+        case TraceEvent::MEM_OUT:
+            return snprintf( line, size, "%lf - Process %u: out of memory, terminating%s\n", time, pid, label );
+        case TraceEvent::MEM_BLOCK_START:
+            return snprintf( line, size, "%lf - Process %u: start memory blocking%s\n", time, pid, label );
+        case TraceEvent::MEM_BLOCK_END:
+            return snprintf( line, size, "%lf - Process %u: end memory blocking%s\n", time, pid, label );
+        case TraceEvent::PAGE_FAULT:
+            return snprintf( line, size, "%lf - Process %u: page fault on page %lu, loading into frame %u%s\n",
+                time, pid, (unsigned long)record.address, record.unit, label );
+        case TraceEvent::PAGE_FAULT_EVICT:
+            return snprintf( line, size, "%lf - Process %u: page fault on page %lu, evicting page %lu of process %u from frame %u%s\n",
+                time, pid, (unsigned long)record.address, (unsigned long)records[1].address, records[1].pid, record.unit, label );
+        case TraceEvent::IO_START:
+        case TraceEvent::IO_END:
+        {
+            char device[32];
+            FormatDevice( device, sizeof device, record.device, record.unit );
+            return snprintf( line, size, "%lf - Process %u: %s %s%s\n", time, pid,
+                record.event == TraceEvent::IO_START ? "start" : "end", device, label );
+        }
+        case TraceEvent::TEXT:
+        {
+            size_t length = record.unit < size ? record.unit : size - 1;
+            memcpy( line, &records[1], length );
+            line[length] = '\0';
+            return record.unit;
+        }
+        default:
+            return -1;
+    }
+}
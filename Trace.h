@@ -0,0 +1,151 @@
+#ifndef _TRACE
+#define _TRACE
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Event of a trace record, every event is one line of text log.
+ *
+ */
+enum class TraceEvent : uint8_t {
+    SIM_START,          // Simulator program starting
+    SIM_END,            // Simulator program ending
+    PREPARE,            // OS: preparing process
+    START_PROCESS,      // OS: starting process
+    COMPLETED,          // Process completed
+    PROC_START,
+    PROC_INTERRUPT,     // Interrupt of processing or memory action
+    PROC_END,
+    MEM_ALLOCATING,
+    MEM_ALLOCATED,      // address is the address allocated
+    MEM_OUT,            // Out of memory, process terminated
+    MEM_BLOCK_START,
+    MEM_BLOCK_END,
+    PAGE_FAULT,         // address is the page, unit the frame
+    PAGE_FAULT_EVICT,   // As PAGE_FAULT, followed by PAGE_EVICTED record
+    PAGE_EVICTED,       // pid and address are process and page evicted
+    IO_START,           // device and unit name the device
+    IO_END,
+    TEXT,               // unit is length of text in records following this one
+    COUNT
+};
+
+/**
+ * @brief IO device named in IO trace records.
+ *
+ */
+enum class TraceDevice : uint8_t {
+    HDD_INPUT, HDD_OUTPUT, PRINTER, SPEAKER, MONITOR, KEYBOARD, MOUSE, COUNT
+};
+
+/**
+ * @brief Fixed-size record of a trace line, as the simulation produces it.
+ * @details Text formatted from the record is the same whether it is
+ *          formatted live or decoded later. Trace file stores records
+ *          encoded by TraceEncoder, not as they are.
+ *
+ */
+struct TraceRecord
+{
+    uint64_t time;          // Simulation time in ns
+    uint64_t address;       // Address or page, untruncated
+    uint32_t pid;
+    TraceEvent event;
+    TraceDevice device;
+    uint16_t core;          // CPU named in the line, TRACE_NO_CORE for none
+    uint32_t unit;          // Device unit, frame or text length
+    uint32_t reserved;      // Zero, keeps records free of padding
+};
+
+static_assert( sizeof(TraceRecord) == 32, "Trace record layout changed" );
+
+const uint16_t TRACE_NO_CORE = 0xFFFF;
+
+/**
+ * @brief Header at the start of binary trace file.
+ *
+ */
+struct TraceHeader
+{
+    char magic[8];          // TRACE_MAGIC
+    uint32_t version;
+    uint32_t reserved;      // Zero
+};
+
+const char TRACE_MAGIC[8] = { 'S', 'I', 'M', 'T', 'R', 'A', 'C', 'E' };
+const uint32_t TRACE_VERSION = 4;
+
+// Encoded line is at most this many bytes longer than its records
+const size_t TRACE_ENCODED_SLACK = 64;
+
+/**
+ * @brief Encodes trace lines into the compact form of trace file.
+ * @details Every line starts with its event byte. Time is stored as the
+ *          difference to the previous line, as a varint of the zigzagged
+ *          mantissa and its count of trailing decimal zeros, so whole
+ *          milliseconds take a byte. Only fields the event prints follow,
+ *          as varints: PID and CPU, IO device and unit, address or page and
+ *          frame, victim of eviction. TEXT lines carry length and text.
+ *          Lines must be encoded in the order they are written.
+ *
+ */
+class TraceEncoder
+{
+    private:
+        uint64_t lastTime;
+
+    public:
+        TraceEncoder();
+
+        /**
+         * @brief Encodes one line.
+         *
+         * @param records Records of the line, TraceRecordCount( records[0] ) of them.
+         * @param out Buffer for at least length of records plus TRACE_ENCODED_SLACK bytes.
+         * @return Number of bytes written to out.
+         */
+        size_t Encode( const TraceRecord *records, char *out );
+};
+
+/**
+ * @brief Decodes one line of trace file written by TraceEncoder.
+ *
+ * @param data Encoded bytes.
+ * @param size Number of bytes available.
+ * @param lastTime Time of previous line, updated.
+ * @param records Buffer for the records of the line.
+ * @param capacity Number of records buffer holds.
+ * @return Number of bytes the line took, 0 if data ends inside the line,
+ *         negative if data is corrupt.
+ */
+long DecodeTrace( const char *data, size_t size, uint64_t &lastTime, TraceRecord *records, size_t capacity );
+
+/**
+ * @brief Returns header of binary trace file.
+ */
+TraceHeader MakeTraceHeader( );
+
+/**
+ * @brief Formats name of IO device as used in log, e.g. "printer output on PRNTR 1".
+ *
+ * @return Length of name as snprintf returns it.
+ */
+int FormatDevice( char *name, size_t size, TraceDevice device, unsigned int unit );
+
+/**
+ * @brief Returns number of records trace line starting with record spans.
+ */
+size_t TraceRecordCount( const TraceRecord &record );
+
+/**
+ * @brief Formats one line of text log.
+ *
+ * @param line Buffer for the line.
+ * @param size Size of buffer.
+ * @param records Records of the line, TraceRecordCount( records[0] ) of them.
+ * @return Length of line as snprintf returns it, negative for unknown event.
+ */
+int FormatTrace( char *line, size_t size, const TraceRecord *records );
+
+#endif // _TRACE
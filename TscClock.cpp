@@ -0,0 +1,79 @@
+#include "TscClock.h"
+
+#ifdef TSC_CLOCK_X86
+#include <cpuid.h>
+#endif
+
+bool TscClock::tsc = false;
+uint64_t TscClock::tscBase = 0;
+uint64_t TscClock::nsBase = 0;
+uint64_t TscClock::mult = 0;
+
+// Calibrate before main, so every thread of the simulation sees the result
+static struct TscCalibration
+{
+    TscCalibration( ) { TscClock::Calibrate(); }
+} calibration;
+
+#ifdef TSC_CLOCK_X86
+/**
+ * @brief Reads TSC and CLOCK_MONOTONIC at the same moment.
+ * @details TSC is read on both sides of the clock read, the midpoint is
+ *          taken from the tightest of a few tries.
+ */
+static void samplePair( uint64_t &ticks, uint64_t &ns )
+{
+    uint64_t best = ~0ull;
+    for( int i = 0; i < 8; ++i )
+    {
+        uint64_t before = __rdtsc();
+        uint64_t now = TscClock::MonotonicNs();
+        uint64_t after = __rdtsc();
+        if( after - before < best )
+        {
+            best = after - before;
+            ticks = before + (after - before) / 2;
+            ns = now;
+        }
+    }
+}
+#endif
+
+void TscClock::Calibrate( )
+{
+#ifdef TSC_CLOCK_X86
+    if( tsc )
+        return;
+
+    // Invariant TSC is bit 8 of EDX of leaf 0x80000007
+    unsigned int eax, ebx, ecx, edx;
+    if( !__get_cpuid( 0x80000000, &eax, &ebx, &ecx, &edx ) || eax < 0x80000007 )
+        return;
+    __get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx );
+    if( !(edx & (1u << 8)) )
+        return;
+
+    uint64_t ticks0, ns0, ticks1, ns1;
+    samplePair( ticks0, ns0 );
+    do
+        samplePair( ticks1, ns1 );
+    while( ns1 - ns0 < 10000000 );
+    if( ticks1 <= ticks0 )
+        return;
+
+    mult = (uint64_t)(((unsigned __int128)(ns1 - ns0) << SHIFT) / (ticks1 - ticks0));
+    tscBase = ticks1;
+    nsBase = ns1;
+    tsc = true;
+#endif
+}
+
+bool TscClock::UsesTsc( )
+{
+    return tsc;
+}
+
+double TscClock::TicksPerNs( )
+{
+    return tsc ? (double)(1ull << SHIFT) / mult : 0.0;
+}
@@ -0,0 +1,76 @@
+#ifndef _TSC_CLOCK
+#define _TSC_CLOCK
+
+#include <cstdint>
+#include <ctime>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#define TSC_CLOCK_X86 1
+#endif
+
+/**
+ * @brief Monotonic nanosecond clock read from the time stamp counter.
+ * @details On CPUs with an invariant TSC the counter ticks at a constant
+ *          rate on every core, so it is read directly and scaled to ns by
+ *          a multiplier calibrated against CLOCK_MONOTONIC when the program
+ *          starts. Ticks are offset to match CLOCK_MONOTONIC at calibration.
+ *          Without an invariant TSC, or before calibration, CLOCK_MONOTONIC
+ *          is read instead.
+ *
+ */
+class TscClock
+{
+    private:
+        static const unsigned int SHIFT = 32;
+
+        static bool tsc;
+        static uint64_t tscBase;
+        static uint64_t nsBase;
+        static uint64_t mult;           // ns per tick, fixed point with SHIFT fraction bits
+
+    public:
+        /**
+         * @brief Calibrates the TSC if it is invariant. Called once at startup.
+         * @details Spins for about 10 ms.
+         */
+        static void Calibrate( );
+
+        /**
+         * @brief Returns true if the TSC is used, false on CLOCK_MONOTONIC fallback.
+         */
+        static bool UsesTsc( );
+
+        /**
+         * @brief Returns TSC frequency in ticks per ns, 0 on fallback.
+         */
+        static double TicksPerNs( );
+
+        /**
+         * @brief Returns CLOCK_MONOTONIC in ns.
+         */
+        static uint64_t MonotonicNs( );
+
+        /**
+         * @brief Returns current time in ns, safe to call from any thread.
+         */
+        static uint64_t NowNs( );
+};
+
+inline uint64_t TscClock::MonotonicNs( )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+inline uint64_t TscClock::NowNs( )
+{
+#ifdef TSC_CLOCK_X86
+    if( tsc )
+        return nsBase + (uint64_t)(((unsigned __int128)(__rdtsc() - tscBase) * mult) >> SHIFT);
+#endif
+    return MonotonicNs();
+}
+
+#endif // _TSC_CLOCK
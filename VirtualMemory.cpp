@@ -0,0 +1,329 @@
+#include "VirtualMemory.h"
+
+#include <cstring>
+
+const unsigned long FifoReplacer::NONE;
+const unsigned long VirtualMemory::NOT_RESIDENT;
+
+PageReplacer::~PageReplacer()
+{
+
+}
+
+PageReplacer *PageReplacer::Create( PageReplacement policy, unsigned long frames )
+{
+    switch( policy )
+    {
+        case PageReplacement::FIFO:  return new FifoReplacer( frames );
+        case PageReplacement::LRU:   return new LruReplacer( frames );
+        case PageReplacement::CLOCK: return new ClockReplacer( frames );
+    }
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+FifoReplacer::FifoReplacer( unsigned long frames ):
+    prev(frames, NONE),
+    next(frames, NONE),
+    head(NONE),
+    tail(NONE)
+{
+
+}
+
+const char *FifoReplacer::Name( ) const
+{
+    return "FIFO";
+}
+
+void FifoReplacer::unlink( unsigned long frame )
+{
+    if( prev[frame] != NONE )
+        next[prev[frame]] = next[frame];
+    else
+        head = next[frame];
+    if( next[frame] != NONE )
+        prev[next[frame]] = prev[frame];
+    else
+        tail = prev[frame];
+    prev[frame] = next[frame] = NONE;
+}
+
+void FifoReplacer::append( unsigned long frame )
+{
+    prev[frame] = tail;
+    next[frame] = NONE;
+    if( tail != NONE )
+        next[tail] = frame;
+    else
+        head = frame;
+    tail = frame;
+}
+
+void FifoReplacer::Loaded( unsigned long frame )
+{
+    append( frame );
+}
+
+void FifoReplacer::Accessed( unsigned long frame )
+{
+
+}
+
+void FifoReplacer::Freed( unsigned long frame )
+{
+    unlink( frame );
+}
+
+unsigned long FifoReplacer::Victim( )
+{
+    return head;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+LruReplacer::LruReplacer( unsigned long frames ):
+    FifoReplacer(frames)
+{
+
+}
+
+const char *LruReplacer::Name( ) const
+{
+    return "LRU";
+}
+
+void LruReplacer::Accessed( unsigned long frame )
+{
+    if( frame == tail )
+        return;
+    unlink( frame );
+    append( frame );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ClockReplacer::ClockReplacer( unsigned long frames ):
+    referenced(frames, false),
+    used(frames, false),
+    hand(0)
+{
+
+}
+
+const char *ClockReplacer::Name( ) const
+{
+    return "CLOCK";
+}
+
+void ClockReplacer::Loaded( unsigned long frame )
+{
+    used[frame] = true;
+    referenced[frame] = true;
+}
+
+void ClockReplacer::Accessed( unsigned long frame )
+{
+    referenced[frame] = true;
+}
+
+void ClockReplacer::Freed( unsigned long frame )
+{
+    used[frame] = false;
+    referenced[frame] = false;
+}
+
+unsigned long ClockReplacer::Victim( )
+{
+    // Second sweep at the latest finds a frame, first one cleared every bit
+    while( !used[hand] || referenced[hand] )
+    {
+        referenced[hand] = false;
+        hand = (hand + 1) % used.size();
+    }
+    unsigned long victim = hand;
+    hand = (hand + 1) % used.size();
+    return victim;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+VirtualMemory::VirtualMemory():
+    replacer(NULL)
+{
+    Reset( 0, 0, 0, PageReplacement::FIFO );
+}
+
+VirtualMemory::~VirtualMemory()
+{
+    delete replacer;
+}
+
+void VirtualMemory::Reset( unsigned long frameCount, unsigned int cores, unsigned int tlbEntries, PageReplacement policy )
+{
+    spaces.clear();
+    frames.assign( frameCount, Frame{0, 0, false} );
+    freeFrames.clear();
+    for( unsigned long frame = frameCount; frame > 0; --frame )
+        freeFrames.push_back( frame - 1 );
+    tlbs.assign( cores, std::vector<TlbEntry>( tlbEntries, TlbEntry{0, 0, 0, 0, false} ) );
+
+    delete replacer;
+    replacer = PageReplacer::Create( policy, frameCount );
+    useCounter = 0;
+    memset( &totals, 0, sizeof totals );
+}
+
+VirtualMemory::AddressSpace &VirtualMemory::space( unsigned int pid )
+{
+    if( pid >= spaces.size() )
+        spaces.resize( pid * 2 + 1 );
+
+    AddressSpace &as = spaces[pid];
+    if( as.pages.empty() )
+    {
+        as.pages.push_back( NOT_RESIDENT );
+        as.nextPage = 0;
+        memset( &as.stats, 0, sizeof as.stats );
+    }
+    return as;
+}
+
+void VirtualMemory::shootdown( unsigned int pid, unsigned long page )
+{
+    for( std::vector<TlbEntry> &tlb : tlbs )
+        for( TlbEntry &entry : tlb )
+            if( entry.valid && entry.pid == pid && entry.page == page )
+                entry.valid = false;
+}
+
+unsigned long VirtualMemory::Allocate( unsigned int pid )
+{
+    AddressSpace &as = space( pid );
+    as.pages.push_back( NOT_RESIDENT );
+    return as.pages.size() - 1;
+}
+
+unsigned long VirtualMemory::Pages( unsigned int pid )
+{
+    return space( pid ).pages.size();
+}
+
+unsigned long VirtualMemory::NextPage( unsigned int pid )
+{
+    AddressSpace &as = space( pid );
+    unsigned long page = as.nextPage % as.pages.size();
+    as.nextPage = page + 1;
+    return page;
+}
+
+PageAccess VirtualMemory::Access( unsigned int core, unsigned int pid, unsigned long page, PageFault &fault )
+{
+    AddressSpace &as = space( pid );
+    ++as.stats.accesses;
+    ++totals.accesses;
+    ++useCounter;
+
+    // TLB lookup, remember least recently used entry for the refill
+    std::vector<TlbEntry> &tlb = tlbs[core];
+    TlbEntry *refill = &tlb[0];
+    for( TlbEntry &entry : tlb )
+    {
+        if( entry.valid && entry.pid == pid && entry.page == page )
+        {
+            entry.lastUse = useCounter;
+            replacer->Accessed( entry.frame );
+            ++as.stats.tlbHits;
+            ++totals.tlbHits;
+            return PageAccess::TLB_HIT;
+        }
+        if( refill->valid && (!entry.valid || entry.lastUse < refill->lastUse) )
+            refill = &entry;
+    }
+
+    // Page table walk
+    PageAccess result = PageAccess::TLB_MISS;
+    if( as.pages[page] == NOT_RESIDENT )
+    {
+        result = PageAccess::FAULT;
+        ++as.stats.faults;
+        ++totals.faults;
+
+        fault.evicted = freeFrames.empty();
+        if( !fault.evicted )
+        {
+            fault.frame = freeFrames.back();
+            freeFrames.pop_back();
+        }
+        else
+        {
+            fault.frame = replacer->Victim();
+            Frame &victim = frames[fault.frame];
+            fault.victimPid = victim.pid;
+            fault.victimPage = victim.page;
+            spaces[victim.pid].pages[victim.page] = NOT_RESIDENT;
+            ++spaces[victim.pid].stats.evictions;
+            ++totals.evictions;
+            shootdown( victim.pid, victim.page );
+            replacer->Freed( fault.frame );
+        }
+
+        frames[fault.frame] = Frame{pid, page, true};
+        as.pages[page] = fault.frame;
+        replacer->Loaded( fault.frame );
+    }
+    else
+        replacer->Accessed( as.pages[page] );
+
+    *refill = TlbEntry{pid, page, as.pages[page], useCounter, true};
+    return result;
+}
+
+void VirtualMemory::ChargePaging( unsigned int pid, unsigned long ms )
+{
+    space( pid ).stats.pagingMs += ms;
+    totals.pagingMs += ms;
+}
+
+PagingStats VirtualMemory::ProcessStats( unsigned int pid )
+{
+    return space( pid ).stats;
+}
+
+void VirtualMemory::Release( unsigned int pid )
+{
+    if( pid >= spaces.size() )
+        return;
+
+    AddressSpace &as = spaces[pid];
+    for( unsigned long page = 0; page < as.pages.size(); ++page )
+    {
+        unsigned long frame = as.pages[page];
+        if( frame == NOT_RESIDENT )
+            continue;
+        frames[frame].used = false;
+        replacer->Freed( frame );
+        freeFrames.push_back( frame );
+    }
+    for( std::vector<TlbEntry> &tlb : tlbs )
+        for( TlbEntry &entry : tlb )
+            if( entry.valid && entry.pid == pid )
+                entry.valid = false;
+    as.pages.clear();
+}
+
+const PagingStats &VirtualMemory::Totals( ) const
+{
+    return totals;
+}
+
+const PageReplacer &VirtualMemory::Policy( ) const
+{
+    return *replacer;
+}
+
+unsigned long VirtualMemory::Frames( ) const
+{
+    return frames.size();
+}
@@ -0,0 +1,280 @@
+#ifndef _VIRTUAL_MEMORY
+#define _VIRTUAL_MEMORY
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Page replacement enumeration.
+ *
+ */
+enum class PageReplacement{
+    FIFO, LRU, CLOCK
+};
+
+/**
+ * @brief Result of a memory access.
+ *
+ */
+enum class PageAccess{
+    TLB_HIT,    // Translation found in TLB
+    TLB_MISS,   // Translation found in page table
+    FAULT       // Page wasn't resident, it was loaded into a frame
+};
+
+/**
+ * @brief Paging counters of a process, or of all processes.
+ *
+ */
+struct PagingStats
+{
+    unsigned long accesses;
+    unsigned long tlbHits;
+    unsigned long faults;
+    unsigned long evictions;    // Pages of the process evicted
+    unsigned long pagingMs;     // Time spent waiting on page-ins
+};
+
+/**
+ * @brief Frame chosen for a faulting page.
+ *
+ */
+struct PageFault
+{
+    unsigned long frame;
+    bool evicted;               // Frame held a page of some process
+    unsigned int victimPid;
+    unsigned long victimPage;
+};
+
+/**
+ * @brief Policy choosing which resident page to evict.
+ * @details Pages are replaced globally, victim may belong to any process.
+ *
+ */
+class PageReplacer
+{
+    public:
+        virtual ~PageReplacer();
+
+        /**
+         * @brief Creates replacement policy.
+         *
+         * @param policy Policy to create.
+         * @param frames Number of physical frames.
+         * @return New policy, owned by caller.
+         */
+        static PageReplacer *Create( PageReplacement policy, unsigned long frames );
+
+        /**
+         * @brief Returns name of policy used in log.
+         */
+        virtual const char *Name( ) const = 0;
+
+        /**
+         * @brief Called when page is loaded into frame.
+         */
+        virtual void Loaded( unsigned long frame ) = 0;
+
+        /**
+         * @brief Called on every access to frame.
+         */
+        virtual void Accessed( unsigned long frame ) = 0;
+
+        /**
+         * @brief Called when frame is freed or its page evicted.
+         */
+        virtual void Freed( unsigned long frame ) = 0;
+
+        /**
+         * @brief Returns frame to evict, called only when every frame is used.
+         */
+        virtual unsigned long Victim( ) = 0;
+};
+
+/**
+ * @brief Evicts page loaded first. Frames are kept in a list in load order.
+ *
+ */
+class FifoReplacer : public PageReplacer
+{
+    protected:
+        static const unsigned long NONE = (unsigned long)-1;
+
+        std::vector<unsigned long> prev;
+        std::vector<unsigned long> next;
+        unsigned long head;
+        unsigned long tail;
+
+        void unlink( unsigned long frame );
+        void append( unsigned long frame );
+
+    public:
+        FifoReplacer( unsigned long frames );
+        const char *Name( ) const;
+        void Loaded( unsigned long frame );
+        void Accessed( unsigned long frame );
+        void Freed( unsigned long frame );
+        unsigned long Victim( );
+};
+
+/**
+ * @brief Evicts page accessed longest ago, accessed frames move to the end of the list.
+ *
+ */
+class LruReplacer : public FifoReplacer
+{
+    public:
+        LruReplacer( unsigned long frames );
+        const char *Name( ) const;
+        void Accessed( unsigned long frame );
+};
+
+/**
+ * @brief Second chance, hand sweeps frames clearing referenced bits and
+ *        evicts first frame not referenced since the last sweep.
+ *
+ */
+class ClockReplacer : public PageReplacer
+{
+    private:
+        std::vector<bool> referenced;
+        std::vector<bool> used;
+        unsigned long hand;
+
+    public:
+        ClockReplacer( unsigned long frames );
+        const char *Name( ) const;
+        void Loaded( unsigned long frame );
+        void Accessed( unsigned long frame );
+        void Freed( unsigned long frame );
+        unsigned long Victim( );
+};
+
+/**
+ * @brief Demand paged virtual memory of all processes.
+ * @details Every process has a page table, its first page exists from the
+ *          start and every allocation adds one. Pages become resident on
+ *          first access. Every core has a fully associative TLB with LRU
+ *          replacement, entries are tagged by PID so they survive context
+ *          switches, and are shot down on every core when the page is
+ *          evicted or its process exits. Not thread-safe.
+ *
+ */
+class VirtualMemory
+{
+    private:
+        static const unsigned long NOT_RESIDENT = (unsigned long)-1;
+
+        struct AddressSpace
+        {
+            std::vector<unsigned long> pages;   // Frame of every page
+            unsigned long nextPage;             // Next page of sequential sweep
+            PagingStats stats;
+        };
+
+        struct Frame
+        {
+            unsigned int pid;
+            unsigned long page;
+            bool used;
+        };
+
+        struct TlbEntry
+        {
+            unsigned int pid;
+            unsigned long page;
+            unsigned long frame;
+            unsigned long lastUse;
+            bool valid;
+        };
+
+        std::vector<AddressSpace> spaces;               // By PID
+        std::vector<Frame> frames;
+        std::vector<unsigned long> freeFrames;
+        std::vector< std::vector<TlbEntry> > tlbs;     // By core
+        PageReplacer *replacer;
+        unsigned long useCounter;
+        PagingStats totals;
+
+        /**
+         * @brief Returns address space of process, creating it with one page.
+         */
+        AddressSpace &space( unsigned int pid );
+
+        /**
+         * @brief Drops translations of page from TLBs of every core.
+         */
+        void shootdown( unsigned int pid, unsigned long page );
+
+    public:
+        VirtualMemory();
+        ~VirtualMemory();
+
+        /**
+         * @brief Drops all address spaces and sets up memory.
+         *
+         * @param frameCount Number of physical frames.
+         * @param cores Number of cores, each has its own TLB.
+         * @param tlbEntries Number of entries of every TLB.
+         * @param policy Page replacement policy.
+         */
+        void Reset( unsigned long frameCount, unsigned int cores, unsigned int tlbEntries, PageReplacement policy );
+
+        /**
+         * @brief Adds a page to address space of process.
+         * @return Index of the new page.
+         */
+        unsigned long Allocate( unsigned int pid );
+
+        /**
+         * @brief Returns number of pages of process.
+         */
+        unsigned long Pages( unsigned int pid );
+
+        /**
+         * @brief Returns next page of process touched by memory blocking,
+         *        processes sweep their pages in order.
+         */
+        unsigned long NextPage( unsigned int pid );
+
+        /**
+         * @brief Accesses page of process from core.
+         *
+         * @param fault Frame the page was loaded into, set if page faulted.
+         * @return Where the translation was found.
+         */
+        PageAccess Access( unsigned int core, unsigned int pid, unsigned long page, PageFault &fault );
+
+        /**
+         * @brief Adds time process waited for a page-in.
+         */
+        void ChargePaging( unsigned int pid, unsigned long ms );
+
+        /**
+         * @brief Returns paging counters of process.
+         */
+        PagingStats ProcessStats( unsigned int pid );
+
+        /**
+         * @brief Frees frames and translations of exited process.
+         */
+        void Release( unsigned int pid );
+
+        /**
+         * @brief Returns paging counters of all processes.
+         */
+        const PagingStats &Totals( ) const;
+
+        /**
+         * @brief Returns replacement policy.
+         */
+        const PageReplacer &Policy( ) const;
+
+        /**
+         * @brief Returns number of physical frames.
+         */
+        unsigned long Frames( ) const;
+};
+
+#endif // _VIRTUAL_MEMORY
@@ -0,0 +1,101 @@
+// Measures cost and resolution of TscClock against the clocks it replaced,
+// its drift from CLOCK_MONOTONIC, and how precise the old float simTime()
+// was compared to the 64-bit ns tick after hours of simulated time.
+
+#include "../TscClock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+static auto simStartTime = std::chrono::high_resolution_clock::now();
+
+// simTime() on real clock as it was before TscClock
+static float oldSimTime( )
+{
+    auto simCurrentTime = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(simCurrentTime - simStartTime).count() / 1e6;
+}
+
+static uint64_t steadyNs( )
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/**
+ * @brief Returns average ns per call of clock.
+ */
+template <class Clock>
+static double cost( Clock clock )
+{
+    const unsigned long calls = 10000000;
+    volatile double sink = 0;
+    uint64_t start = TscClock::MonotonicNs();
+    for( unsigned long i = 0; i < calls; ++i )
+        sink = sink + clock();
+    return (double)(TscClock::MonotonicNs() - start) / calls;
+}
+
+/**
+ * @brief Returns smallest step between consecutive different readings of clock, in ns.
+ */
+template <class Clock>
+static double resolution( Clock clock, double nsPerUnit )
+{
+    double best = INFINITY;
+    for( int i = 0; i < 100000; ++i )
+    {
+        double first = clock();
+        double next;
+        while( (next = clock()) == first );
+        best = std::min( best, (next - first) * nsPerUnit );
+    }
+    return best;
+}
+
+int main( int argc, char **argv )
+{
+    if( TscClock::UsesTsc() )
+        printf( "Invariant TSC at %.3lf ticks per ns\n\n", TscClock::TicksPerNs() );
+    else
+        printf( "No invariant TSC, TscClock falls back to CLOCK_MONOTONIC\n\n" );
+
+    printf( "%-36s %12s %16s\n", "clock", "ns per call", "resolution ns" );
+    printf( "%-36s %12.1lf %16.1lf\n", "TscClock::NowNs",
+        cost( []{ return (double)TscClock::NowNs(); } ),
+        resolution( []{ return (double)TscClock::NowNs(); }, 1 ) );
+    printf( "%-36s %12.1lf %16.1lf\n", "clock_gettime(CLOCK_MONOTONIC)",
+        cost( []{ return (double)TscClock::MonotonicNs(); } ),
+        resolution( []{ return (double)TscClock::MonotonicNs(); }, 1 ) );
+    printf( "%-36s %12.1lf %16.1lf\n", "steady_clock::now",
+        cost( []{ return (double)steadyNs(); } ),
+        resolution( []{ return (double)steadyNs(); }, 1 ) );
+    printf( "%-36s %12.1lf %16.1lf\n", "old simTime (float seconds)",
+        cost( []{ return (double)oldSimTime(); } ),
+        resolution( []{ return (double)oldSimTime(); }, 1e9 ) );
+
+    // Drift of the calibrated rate against the clock it was calibrated on
+    uint64_t tsc0 = TscClock::NowNs();
+    uint64_t mono0 = TscClock::MonotonicNs();
+    while( TscClock::MonotonicNs() - mono0 < 500000000 );
+    int64_t tscSpan = TscClock::NowNs() - tsc0;
+    int64_t monoSpan = TscClock::MonotonicNs() - mono0;
+    printf( "\nDrift from CLOCK_MONOTONIC over %.1lf s: %.2lf ppm\n", monoSpan / 1e9,
+        (double)(tscSpan - monoSpan) / monoSpan * 1e6 );
+
+    // Smallest step representable at a given simulation time
+    printf( "\n%-36s %16s %16s %16s\n", "simTime precision after", "1 h", "3 h", "24 h" );
+    double hours[] = { 1, 3, 24 };
+    printf( "%-36s", "float seconds (old)" );
+    for( double h : hours )
+    {
+        float t = h * 3600;
+        printf( " %13.3lf ms", (std::nextafter( t, INFINITY ) - t) * 1e3 );
+    }
+    printf( "\n%-36s", "uint64_t ns tick" );
+    for( int i = 0; i < 3; ++i )
+        printf( " %13.6lf ms", 1e-6 );
+    printf( "\n" );
+    return 0;
+}
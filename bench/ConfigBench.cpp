@@ -0,0 +1,202 @@
+// Compares per-event cost of the config reads done while dispatching:
+// handleProc, handleMem and allocateMemory looking cycle times and block
+// size up by label in ConfigManager, as they did before SimConfig, against
+// reading the fields of SimConfig. Events are a generated mix of P and M.
+// Also compares reading a config file with the two regexes ReadConfigFile
+// compiled on every run before ConfigManager::ParseLine, and with it.
+
+#include "../ConfigManager.h"
+#include "../SimConfig.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Event
+{
+    char code;
+    bool allocate;
+    unsigned int cycles;
+};
+
+// Dispatch work of one event as handleProc and handleMem did it before SimConfig
+__attribute__((noinline))
+static unsigned long lookupDispatch( ConfigManager &config, const Event &event )
+{
+    if( event.code == 'P' )
+        return event.cycles * config.GetInt( "Processor cycle time (msec)" );
+    unsigned long time = event.cycles * config.GetInt( "Memory cycle time (msec)" );
+    if( event.allocate )
+        time += config.GetInt( "Memory block size (kbytes)" );
+    return time;
+}
+
+// Same work reading SimConfig
+__attribute__((noinline))
+static unsigned long typedDispatch( const SimConfig &settings, const Event &event )
+{
+    if( event.code == 'P' )
+        return event.cycles * settings.processorCycleMs;
+    unsigned long time = event.cycles * settings.memoryCycleMs;
+    if( event.allocate )
+        time += settings.memoryBlockKb;
+    return time;
+}
+
+// Config file of the samples
+static const char configFile[] =
+    "Version/Phase: 4.0\n"
+    "File Path: Test_4a.mdf\n"
+    "Quantum Number (msec): 50\n"
+    "CPU Scheduling Code: SRTF\n"
+    "Processor cycle time (msec): 5\n"
+    "Monitor display time (msec): 22\n"
+    "Hard drive cycle time (msec): 150\n"
+    "Printer cycle time (msec): 550\n"
+    "Keyboard cycle time (msec): 60\n"
+    "Memory cycle time (msec): 10\n"
+    "System memory (kbytes): 2048\n"
+    "Memory block size (kbytes): 128\n"
+    "Printer quantity: 4\n"
+    "Hard drive quantity: 2\n"
+    "\n"
+    "Log: Log to File\n"
+    "Log File Path: logfile_1.lgf\n";
+
+// Config options read as ReadConfigFile did before ConfigManager::ParseLine
+static size_t regexRead( )
+{
+    std::regex rConfigLine(R"(^\s*([\S\t ]*?)\s*:\s*([\S\t ]+?)\s*$)");
+    std::regex rEmptyLine(R"(^\s*$)");
+    std::istringstream file( configFile );
+    std::string line;
+    size_t length = 0;
+    while( getline( file, line ) )
+    {
+        std::smatch sm;
+        if( regex_search( line, sm, rConfigLine ) )
+            length += sm.length(1) + sm.length(2);
+        else if( !regex_search( line, sm, rEmptyLine ) )
+            return 0;
+    }
+    return length;
+}
+
+static size_t parseRead( )
+{
+    std::istringstream file( configFile );
+    std::string line;
+    size_t length = 0;
+    std::string_view label, value;
+    while( getline( file, line ) )
+    {
+        if( ConfigManager::ParseLine( line, label, value ) )
+            length += label.size() + value.size();
+        else if( line.find_first_not_of( " \t\n\v\f\r" ) != std::string::npos )
+            return 0;
+    }
+    return length;
+}
+
+template <class Read>
+static double usPerFile( Read read, int files, size_t &length )
+{
+    auto start = std::chrono::steady_clock::now();
+    for( int i = 0; i < files; ++i )
+        length = read();
+    return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count() / files;
+}
+
+template <class Dispatch>
+static double nsPerEvent( Dispatch dispatch, const std::vector<Event> &events, int runs, unsigned long &sum )
+{
+    double best = 0;
+    for( int run = 0; run < runs; ++run )
+    {
+        sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for( const Event &event : events )
+            sum += dispatch( event );
+        double ns = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+        if( run == 0 || ns / events.size() < best )
+            best = ns / events.size();
+    }
+    return best;
+}
+
+int main( int argc, char **argv )
+{
+    unsigned long count = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 2000000;
+
+    // Int options of Simulation
+    static constexpr ConfigOptionSpec options[] = {
+        ConfigDefault( "Monitor display time (msec)", ConfigType::Int, "1" ),
+        ConfigDefault( "Processor cycle time (msec)", ConfigType::Int, "10" ),
+        ConfigDefault( "Hard drive cycle time (msec)", ConfigType::Int, "1" ),
+        ConfigDefault( "Printer cycle time (msec)", ConfigType::Int, "1" ),
+        ConfigDefault( "Keyboard cycle time (msec)", ConfigType::Int, "1" ),
+        ConfigDefault( "Mouse cycle time (msec)", ConfigType::Int, "1" ),
+        ConfigDefault( "Speaker cycle time (msec)", ConfigType::Int, "1" ),
+        ConfigDefault( "Memory cycle time (msec)", ConfigType::Int, "5" ),
+        ConfigDefault( "System memory (kbytes)", ConfigType::Int, "1" ),
+        ConfigDefault( "Memory block size (kbytes)", ConfigType::Int, "128" ),
+        ConfigDefault( "Printer quantity", ConfigType::Int, "1" ),
+        ConfigDefault( "Hard drive quantity", ConfigType::Int, "1" ),
+        ConfigDefault( "Speaker quantity", ConfigType::Int, "1" ),
+        ConfigDefault( "Quantum Number (msec)", ConfigType::Int, "1" ),
+        ConfigDefault( "CPU count", ConfigType::Int, "1" ),
+        ConfigDefault( "TLB Entries", ConfigType::Int, "1" ),
+        ConfigDefault( "MLFQ Queue Count", ConfigType::Int, "1" )
+    };
+    static const ConfigSchema schema( options );
+    ConfigManager config( schema );
+
+    SimConfig settings = SimConfig();
+    settings.processorCycleMs = config.GetInt( "Processor cycle time (msec)" );
+    settings.memoryCycleMs = config.GetInt( "Memory cycle time (msec)" );
+    settings.memoryBlockKb = config.GetInt( "Memory block size (kbytes)" );
+
+    std::vector<Event> events( count );
+    srand( 1 );
+    for( Event &event : events )
+    {
+        event.code = rand() % 3 ? 'P' : 'M';
+        event.allocate = event.code == 'M' && rand() % 2;
+        event.cycles = 1 + rand() % 20;
+    }
+
+    unsigned long lookupSum, typedSum;
+    double lookupNs = nsPerEvent( [&]( const Event &event ) { return lookupDispatch( config, event ); }, events, 3, lookupSum );
+    double typedNs = nsPerEvent( [&]( const Event &event ) { return typedDispatch( settings, event ); }, events, 3, typedSum );
+
+    if( lookupSum != typedSum )
+    {
+        printf( "Dispatch results disagree: %lu vs %lu\n", lookupSum, typedSum );
+        return 1;
+    }
+
+    size_t regexLength, parseLength;
+    double regexUs = usPerFile( regexRead, 2000, regexLength );
+    double parseUs = usPerFile( parseRead, 2000, parseLength );
+    if( regexLength == 0 || regexLength != parseLength )
+    {
+        printf( "Config readers disagree: %zu vs %zu characters\n", regexLength, parseLength );
+        return 1;
+    }
+
+    printf( "%lu events\n\n", count );
+    printf( "%-28s %16s\n", "config read", "ns per event" );
+    printf( "%-28s %16.2lf\n", "ConfigManager::GetInt (old)", lookupNs );
+    printf( "%-28s %16.2lf\n", "SimConfig field", typedNs );
+    printf( "\nSpeedup: %.1lfx\n\n", lookupNs / typedNs );
+
+    printf( "%-28s %16s\n", "config file read", "us per file" );
+    printf( "%-28s %16.2lf\n", "std::regex (old)", regexUs );
+    printf( "%-28s %16.2lf\n", "ConfigManager::ParseLine", parseUs );
+    printf( "\nSpeedup: %.1lfx\n", regexUs / parseUs );
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Compares bitmap MemoryManager allocation against a naive bit by bit scan.
+// Memory is filled up, then a tenth of the processes exit leaving holes all
+// over it, and it is kept that full by processes exiting and allocating.
+// Exits are timed too, a process exit must not scan all of memory.
+
+#include "../MemoryManager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * @brief Next-fit allocator testing one block at a time.
+ *
+ */
+class NaiveMemory
+{
+    private:
+        std::vector<bool> used;
+        std::vector< std::vector< std::pair<unsigned long, unsigned long> > > owned;
+        unsigned long cursor;
+
+    public:
+        NaiveMemory( unsigned long blocks, unsigned int pids ):
+            used(blocks), owned(pids), cursor(0)
+        {
+
+        }
+
+        bool Allocate( unsigned int pid, unsigned long blocks, unsigned long &start )
+        {
+            unsigned long size = used.size();
+            unsigned long run = 0;
+            for( unsigned long i = 0; i < 2 * size; ++i )
+            {
+                unsigned long block = (cursor + i) % size;
+                if( block == 0 )
+                    run = 0;
+                run = used[block] ? 0 : run + 1;
+                if( run == blocks )
+                {
+                    start = block + 1 - blocks;
+                    for( unsigned long b = start; b <= block; ++b )
+                        used[b] = true;
+                    owned[pid].push_back( std::make_pair( start, blocks ) );
+                    cursor = (block + 1) % size;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void FreeAll( unsigned int pid )
+        {
+            for( auto &extent : owned[pid] )
+                for( unsigned long b = extent.first; b < extent.first + extent.second; ++b )
+                    used[b] = false;
+            owned[pid].clear();
+        }
+};
+
+struct Timing
+{
+    double allocateNs;
+    double freeNs;
+};
+
+template <class Allocate, class FreeAll>
+static Timing run( unsigned long maxSize, Allocate allocate, FreeAll freeAll )
+{
+    const unsigned int pids = 4096;
+    const unsigned long rounds = 2000;
+    srand( 1 );
+
+    // Fill memory with allocations of 1-maxSize blocks, then free a tenth of them
+    unsigned long start;
+    while( allocate( rand() % pids, 1 + rand() % maxSize, start ) );
+    for( unsigned int pid = 0; pid < pids; pid += 10 )
+        freeAll( pid );
+
+    unsigned long allocations = 0;
+    std::chrono::nanoseconds spent( 0 );
+    std::chrono::nanoseconds freeing( 0 );
+    for( unsigned long i = 0; i < rounds; ++i )
+    {
+        unsigned int pid = rand() % pids;
+        auto f_start = std::chrono::steady_clock::now();
+        freeAll( pid );
+        freeing += std::chrono::steady_clock::now() - f_start;
+        for( int j = 0; j < 4; ++j )
+        {
+            unsigned long size = 1 + rand() % maxSize;
+            auto t_start = std::chrono::steady_clock::now();
+            allocate( pid, size, start );
+            spent += std::chrono::steady_clock::now() - t_start;
+            ++allocations;
+        }
+    }
+    return Timing{ (double)spent.count() / allocations, (double)freeing.count() / rounds };
+}
+
+int main( int argc, char **argv )
+{
+    unsigned long sizes[] = { 1ul << 14, 1ul << 20, 1ul << 22 };
+    unsigned long maxSizes[] = { 8, 256 };
+    printf( "%12s %10s %14s %14s %14s %14s\n", "blocks", "max alloc", "bitmap ns", "naive ns", "bitmap exit ns", "naive exit ns" );
+    for( unsigned long maxSize : maxSizes )
+    {
+        for( unsigned long blocks : sizes )
+        {
+            MemoryManager memory;
+            memory.Reset( blocks, 0 );
+            Timing bitmap = run( maxSize,
+                [&]( unsigned int pid, unsigned long size, unsigned long &start ){ return memory.Allocate( pid, size, 0, start ); },
+                [&]( unsigned int pid ){ memory.FreeAll( pid, 0 ); } );
+
+            NaiveMemory naive( blocks, 4096 );
+            Timing scan = run( maxSize,
+                [&]( unsigned int pid, unsigned long size, unsigned long &start ){ return naive.Allocate( pid, size, start ); },
+                [&]( unsigned int pid ){ naive.FreeAll( pid ); } );
+
+            printf( "%12lu %10lu %14.1lf %14.1lf %14.1lf %14.1lf\n", blocks, maxSize,
+                bitmap.allocateNs, scan.allocateNs, bitmap.freeNs, scan.freeNs );
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+// Compares events per second of the memory-mapped MetaDataParser against
+// the getline, strSplit and regex path ReadMetaData used before it, on a
+// generated meta-data file. Both paths run the same event handler.
+
+#include "../MetaDataParser.h"
+#include "../helpers.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using SimHelpers::strTrim;
+using SimHelpers::strSplit;
+
+struct Totals
+{
+    unsigned long events;
+    unsigned long sum;      // Of codes, descriptor lengths and cycles, to compare paths
+};
+
+static void count( Totals &totals, char code, size_t descriptorLength, long int cycles )
+{
+    totals.events++;
+    totals.sum += code + descriptorLength + cycles;
+}
+
+// ReadMetaData as it was before MetaDataParser
+static Totals regexParse( const std::string &mdFile )
+{
+    const std::string mdHeader = "Start Program Meta-Data Code:";
+    const std::string mdFooter = "End Program Meta-Data Code.";
+
+    std::fstream fl( mdFile, std::ios::in );
+    if( !fl.is_open() )
+        throw std::runtime_error( "Unable to open meta-data file" );
+
+    std::string line;
+    std::string mdStr = "";
+    if( getline( fl, line ) )
+        line = strTrim( line );
+    if( line != mdHeader )
+        throw std::runtime_error( "Meta-Data header is missing!" );
+    while( getline( fl, line ) )
+    {
+        line = strTrim( line );
+        if( line == mdFooter )
+            break;
+        mdStr += line;
+    }
+    if( line != mdFooter )
+        throw std::runtime_error( "Meta-Data footer is missing!" );
+    if( mdStr.back() != '.' )
+        throw std::runtime_error( "Meta-Data is missing period at the end of events!" );
+    mdStr.pop_back();
+
+    std::vector<std::string> tokens;
+    strSplit( mdStr, ';', tokens );
+
+    std::regex rEvent( R"(^\s*([A-Z])\s*\(\s*([a-z\s]*)\s*\)\s*(\d+)\s*$)" );
+    std::smatch sm;
+    Totals totals = { 0, 0 };
+    for( auto it = tokens.begin(); it != tokens.end(); it++ )
+    {
+        if( !regex_search( *it, sm, rEvent ) )
+            throw std::runtime_error( "Unable to parse following event: " + *it );
+        count( totals, sm.str(1)[0], sm.str(2).size(), strtol( sm.str(3).c_str(), NULL, 10 ) );
+    }
+    return totals;
+}
+
+static Totals mappedParse( const std::string &mdFile )
+{
+    MetaDataParser parser;
+    if( !parser.Open( mdFile ) )
+        throw std::runtime_error( "Unable to open meta-data file" );
+    Totals totals = { 0, 0 };
+    parser.Parse( [&]( char code, std::string_view descriptor, long int cycles ) {
+        count( totals, code, descriptor.size(), cycles );
+    } );
+    return totals;
+}
+
+// Writes meta-data of applications in the layout of the sample files
+static void generate( const std::string &path, unsigned long applications )
+{
+    static const char * const events[] = {
+        "P(run)11", "M(allocate)2", "O(hard drive)6", "P(run)9", "I(keyboard)3",
+        "M(block)4", "O(monitor)5", "I(hard drive)8", "O(printer)2", "P(run)7"
+    };
+    FILE *file = fopen( path.c_str(), "w" );
+    fprintf( file, "Start Program Meta-Data Code:\nS(start)0; " );
+    for( unsigned long app = 0; app < applications; ++app )
+    {
+        fprintf( file, "A(start)0; " );
+        for( unsigned int i = 0; i < 10; ++i )
+            fprintf( file, "%s;%s", events[(app + i) % 10], i % 4 == 3 ? "\n" : " " );
+        fprintf( file, "A(end)0;\n" );
+    }
+    fprintf( file, "S(end)0.\nEnd Program Meta-Data Code.\n" );
+    fclose( file );
+}
+
+template <class Parse>
+static double eventsPerSecond( Parse parse, const std::string &path, int runs, Totals &totals )
+{
+    double best = 0;
+    for( int run = 0; run < runs; ++run )
+    {
+        auto start = std::chrono::steady_clock::now();
+        totals = parse( path );
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        if( totals.events / seconds > best )
+            best = totals.events / seconds;
+    }
+    return best;
+}
+
+int main( int argc, char **argv )
+{
+    unsigned long applications = argc > 1 ? strtoul( argv[1], NULL, 10 ) : 50000;
+    char path[] = "/tmp/MetaDataBenchXXXXXX";
+    int fd = mkstemp( path );
+    if( fd < 0 )
+    {
+        perror( "mkstemp" );
+        return 1;
+    }
+    close( fd );
+    generate( path, applications );
+
+    Totals regexTotals, mappedTotals;
+    double regexRate = eventsPerSecond( regexParse, path, 3, regexTotals );
+    double mappedRate = eventsPerSecond( mappedParse, path, 3, mappedTotals );
+    unlink( path );
+
+    if( regexTotals.events != mappedTotals.events || regexTotals.sum != mappedTotals.sum )
+    {
+        printf( "Parsers disagree: %lu events (sum %lu) vs %lu events (sum %lu)\n",
+            regexTotals.events, regexTotals.sum, mappedTotals.events, mappedTotals.sum );
+        return 1;
+    }
+
+    printf( "%lu events in %lu applications\n\n", mappedTotals.events, applications );
+    printf( "%-28s %16s\n", "parser", "events per s" );
+    printf( "%-28s %16.0lf\n", "getline + regex (old)", regexRate );
+    printf( "%-28s %16.0lf\n", "mmap + string_view", mappedRate );
+    printf( "\nSpeedup: %.1lfx\n", mappedRate / regexRate );
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @brief Decodes binary trace written with "Log Format: Binary" to text log.
+ * @details Output is the same the simulator writes with "Log Format: Text".
+ *
+ *          Usage: TraceDecoder <trace file> [text log file]
+ *          Text log goes to standard output when no file is given.
+ */
+
+#include "../Trace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+int main( int argc, char *argv[] )
+{
+    if( argc < 2 || argc > 3 )
+    {
+        fprintf( stderr, "Usage: %s <trace file> [text log file]\n", argv[0] );
+        return 1;
+    }
+
+    FILE *in = fopen( argv[1], "rb" );
+    if( !in )
+    {
+        fprintf( stderr, "Unable to open trace file: %s\n", argv[1] );
+        return 1;
+    }
+    FILE *out = argc == 3 ? fopen( argv[2], "w" ) : stdout;
+    if( !out )
+    {
+        fprintf( stderr, "Unable to open text log file: %s\n", argv[2] );
+        return 1;
+    }
+
+    TraceHeader header;
+    if( fread( &header, sizeof header, 1, in ) != 1
+        || memcmp( header.magic, TRACE_MAGIC, sizeof header.magic ) != 0 )
+    {
+        fprintf( stderr, "Not a trace file: %s\n", argv[1] );
+        return 1;
+    }
+    if( header.version != TRACE_VERSION )
+    {
+        fprintf( stderr, "Unsupported trace version %u\n", header.version );
+        return 1;
+    }
+
+    // Bytes are read in blocks, a line cut by the end of block is carried to the next one
+    const size_t BLOCK = 65536;
+    std::vector<char> data( BLOCK );
+    TraceRecord records[1024 / sizeof(TraceRecord)];
+    size_t count = 0;
+    uint64_t time = 0;
+    unsigned long lines = 0;
+    char line[1024];
+    while( true )
+    {
+        size_t read = fread( &data[count], 1, data.size() - count, in );
+        count += read;
+
+        size_t pos = 0;
+        while( pos < count )
+        {
+            long used = DecodeTrace( &data[pos], count - pos, time, records, sizeof records / sizeof records[0] );
+            if( used < 0 )
+            {
+                fprintf( stderr, "Corrupt trace line %lu\n", lines );
+                return 1;
+            }
+            if( !used )
+                break;
+            int length = FormatTrace( line, sizeof line, records );
+            fwrite( line, 1, length < (int)sizeof line ? length : sizeof line - 1, out );
+            pos += used;
+            ++lines;
+        }
+
+        memmove( &data[0], &data[pos], count - pos );
+        count -= pos;
+        if( !read )
+            break;
+    }
+    if( count )
+        fprintf( stderr, "Trace ends with an incomplete line\n" );
+
+    fclose( in );
+    if( out != stdout )
+        fclose( out );
+    return 0;
+}